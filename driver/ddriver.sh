@@ -3,6 +3,7 @@ ORIGIN_WORK_DIR="$PWD"
 
 KERNEL_DDRIVER="./kernel_ddriver"
 KERNEL_DEV_PATH="/dev/ddriver"
+KERNEL_DISK_SZ_PATH="/sys/module/ddriver/parameters/disk_size"
 
 USER_DDRIVER="./user_ddriver"
 USER_LOG_PATH="$HOME/ddriver_log"
@@ -21,6 +22,15 @@ cd "$WORK_DIR" || exit
 CONFIG_BLOCK_SZ=512
 BLOCK_COUNT=8192
 
+# 内核设备的块数，随模块参数disk_size变化（安装时由环境变量DDRIVER_DISK_SIZE指定，单位字节）
+function kernel_block_count(){
+    if [ -r "$KERNEL_DISK_SZ_PATH" ]; then
+        echo $(( $(cat "$KERNEL_DISK_SZ_PATH") / CONFIG_BLOCK_SZ ))
+    else
+        echo $BLOCK_COUNT
+    fi
+}
+
 
 function usage(){
     echo '''
@@ -80,7 +90,7 @@ function install() {
         sudo rm $KERNEL_DEV_PATH>/dev/null 2>&1 
         sudo rmmod ddriver>/dev/null 2>&1 
         sudo dmesg -C
-        sudo insmod ./ddriver.ko
+        sudo insmod ./ddriver.ko ${DDRIVER_DISK_SIZE:+disk_size=$DDRIVER_DISK_SIZE}
         in=$(dmesg | tail -n 1)
         tokens=("$in")
         major_number=${tokens[${#tokens[*]}-1]}
@@ -123,11 +133,11 @@ function install() {
 function test(){
     if [ "$DDRIVER_TYPE" == "k" ]; then   
         # test read
-        sudo dd if=$KERNEL_DEV_PATH of=read1 bs=$CONFIG_BLOCK_SZ count=$BLOCK_COUNT
+        sudo dd if=$KERNEL_DEV_PATH of=read1 bs=$CONFIG_BLOCK_SZ count=$(kernel_block_count)
         # test write
         sudo dd if=/dev/random of=$KERNEL_DEV_PATH bs=$CONFIG_BLOCK_SZ count=2
         # test read
-        sudo dd if=$KERNEL_DEV_PATH of=read2 bs=$CONFIG_BLOCK_SZ count=$BLOCK_COUNT
+        sudo dd if=$KERNEL_DEV_PATH of=read2 bs=$CONFIG_BLOCK_SZ count=$(kernel_block_count)
     else 
         exit
     fi
@@ -145,7 +155,7 @@ function dump(){
     sudo rm "$ORIGIN_WORK_DIR"/ddriver_dump>/dev/null 2>&1 
     if [ "$DDRIVER_TYPE" == "k" ]; then  
         echo "目标设备 $KERNEL_DEV_PATH"
-        sudo dd if=$KERNEL_DEV_PATH of="$ORIGIN_WORK_DIR"/ddriver_dump bs=$CONFIG_BLOCK_SZ count=$BLOCK_COUNT
+        sudo dd if=$KERNEL_DEV_PATH of="$ORIGIN_WORK_DIR"/ddriver_dump bs=$CONFIG_BLOCK_SZ count=$(kernel_block_count)
     else 
         echo "目标设备 $USER_DEV_PATH"
         dd if="$USER_DEV_PATH" of="$ORIGIN_WORK_DIR"/ddriver_dump bs=$CONFIG_BLOCK_SZ count=$BLOCK_COUNT
@@ -156,7 +166,7 @@ function dump(){
 function clean(){
     if [ "$DDRIVER_TYPE" == "k" ]; then  
         echo "目标设备 $KERNEL_DEV_PATH"
-        sudo dd if=/dev/zero of=$KERNEL_DEV_PATH bs=$CONFIG_BLOCK_SZ count=$BLOCK_COUNT
+        sudo dd if=/dev/zero of=$KERNEL_DEV_PATH bs=$CONFIG_BLOCK_SZ count=$(kernel_block_count)
     else
         echo "目标设备 $USER_DEV_PATH"
         dd if=/dev/zero of="$USER_DEV_PATH" bs=$CONFIG_BLOCK_SZ count=$BLOCK_COUNT
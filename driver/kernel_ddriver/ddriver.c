@@ -4,6 +4,9 @@
 #include <linux/fs.h>
 #include <asm/uaccess.h>
 #include <linux/uaccess.h>
+#include <linux/moduleparam.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
 #include "ddriver_ctl.h"
 /******************************************************************************
 * SECTION: Macro definitions
@@ -27,7 +30,7 @@
                         "filp_open/cpp-filp_open-function-examples.html>"
 #define DRIVER_VERSION  "0.1.0"
 
-#define CONFIG_DISK_SZ  (4 * 1024 * 1024)
+#define CONFIG_DISK_SZ  (4 * 1024 * 1024)                 /* Default of disk_size */
 #define CONFIG_BLOCK_SZ (512)
 /******************************************************************************
 * SECTION: Macro Functions 
@@ -36,14 +39,9 @@
 #define IS_ADDR_ALIGN(addr)     (addr % CONFIG_BLOCK_SZ == 0)
 #define ADDR_ROUND_UP(addr)     ((addr / CONFIG_BLOCK_SZ) * CONFIG_BLOCK_SZ)
 
-#define GET_HEAD_POS(disk)      (disk.head - disk.layout)
-#define FORWARD_HEAD(disk, dis) (disk.head += dis)
-#define SET_HEAD(disk, ofs)     (disk.head = disk.layout + ofs)
-#define RESET_HEAD(disk)        (SET_HEAD(disk, 0))
-
-#define INC_READCNT(disk)       (disk.read_cnt++)
-#define INC_WRITECNT(disk)      (disk.write_cnt++)
-#define INC_SEEKCNT(disk)       (disk.seek_cnt++)
+#define INC_READCNT(disk, n)    (atomic_add(n, &disk.read_cnt))
+#define INC_WRITECNT(disk, n)   (atomic_add(n, &disk.write_cnt))
+#define INC_SEEKCNT(disk)       (atomic_inc(&disk.seek_cnt))
 /******************************************************************************
 * SECTION: Kernel Module Template
 *******************************************************************************/
@@ -51,55 +49,65 @@ MODULE_LICENSE("GPL");
 MODULE_AUTHOR(DRIVER_AUTHOR);	    
 MODULE_DESCRIPTION(DRIVER_DESC);	
 MODULE_VERSION(DRIVER_VERSION);	
+
+static unsigned long disk_size = CONFIG_DISK_SZ;
+module_param(disk_size, ulong, 0444);
+MODULE_PARM_DESC(disk_size, "Disk size in bytes, multiple of 512, default 4MiB");
 /******************************************************************************
 * SECTION: Type definitions
 *******************************************************************************/
 struct ddriver
 {
-    char layout[CONFIG_DISK_SZ];                      /* Disk Layout */
-    char *head;                                       /* Disk Head */
-    int  read_cnt;
-    int  write_cnt;
-    int  seek_cnt;
+    char *layout;                                     /* Disk Layout, vmalloc_user at load, mappable */
+    atomic_t read_cnt;                                /* Sectors read */
+    atomic_t write_cnt;                               /* Sectors written */
+    atomic_t seek_cnt;
     int  major_num;
-    int  open_count;
+    atomic_t open_count;                              /* Each opener has its own head, file->f_pos */
     int  layout_size;
     int  iounit_size;
 };
 
 static struct ddriver disk = {
-    .head        = NULL,
-    .read_cnt    = 0,
-    .write_cnt   = 0,
-    .seek_cnt    = 0,
+    .read_cnt    = ATOMIC_INIT(0),
+    .write_cnt   = ATOMIC_INIT(0),
+    .seek_cnt    = ATOMIC_INIT(0),
     .major_num   = 0,
-    .open_count  = 0,
-    .layout_size = CONFIG_DISK_SZ,
+    .open_count  = ATOMIC_INIT(0),
+    .layout_size = 0,                                 /* Set from disk_size at load */
     .iounit_size = CONFIG_BLOCK_SZ
 };
 /******************************************************************************
 * SECTION: Helper Functions
 *******************************************************************************/
-int check_valid(size_t size){
-    if (GET_HEAD_POS(disk) >=  CONFIG_DISK_SZ) {
+/**
+ * @brief Check a transfer of size bytes at pos
+ * 
+ * @param pos           Disk offset, aligned to @CONFIG_BLOCK_SZ
+ * @param size          Multiple of @CONFIG_BLOCK_SZ
+ * @return ssize_t      Bytes to transfer, truncated at the end of disk
+ */
+ssize_t check_valid(loff_t pos, size_t size){
+    if (pos < 0 || pos >= disk.layout_size) {
         kernel_alert("disk head reach the end");
         return -EINVAL;
     }
-    if (size != CONFIG_BLOCK_SZ){
-        kernel_alert("io size %ld should align to %d", size, CONFIG_BLOCK_SZ);
+    if (size == 0 || size % CONFIG_BLOCK_SZ != 0 || !IS_ADDR_ALIGN(pos)){
+        kernel_alert("io size %zu at %lld should align to %d", size, pos, CONFIG_BLOCK_SZ);
         return -EIO;
     }
-    return 0;
+    return min_t(size_t, size, disk.layout_size - pos);
 }
 /******************************************************************************
 * SECTION: Function definitions
 *******************************************************************************/
 static int      device_open(struct inode *, struct file *);
 static int      device_release(struct inode *, struct file *);
-static ssize_t  device_read(struct file *, char *, size_t, loff_t *);
-static ssize_t  device_write(struct file *, const char *, size_t, loff_t *);
+static ssize_t  device_read(struct file *, char __user *, size_t, loff_t *);
+static ssize_t  device_write(struct file *, const char __user *, size_t, loff_t *);
 static loff_t   device_seek(struct file *, loff_t, int);
 static long     device_ioctl(struct file *, unsigned int, unsigned long);
+static int      device_mmap(struct file *, struct vm_area_struct *);
 /******************************************************************************
 * SECTION: Global var or structure definitions
 *******************************************************************************/
@@ -109,6 +117,7 @@ static struct file_operations file_ops = {
     .open = device_open,
     .llseek = device_seek,
     .unlocked_ioctl = device_ioctl,
+    .mmap = device_mmap,
     .release = device_release
 };
 /******************************************************************************
@@ -119,75 +128,66 @@ static struct file_operations file_ops = {
  * 
  * @param file          Ignored
  * @param user_buffer   User space buffer
- * @param size          Must equal to Blocksize @CONFIG_BLOCK_SZ
- * @param offset        Ignored
- * @return ssize_t      Bytes have been read 
+ * @param size          Multiple of Blocksize @CONFIG_BLOCK_SZ, one copy for all sectors
+ * @param offset        Disk offset, &file->f_pos for read(2), caller's for pread(2)
+ * @return ssize_t      Bytes have been read, 0 at or past the end of disk
  */
 static ssize_t 
-device_read(struct file *file, char *user_buffer, size_t size, loff_t *offset) {
-    IGNORE_ARG(offset);
+device_read(struct file *file, char __user *user_buffer, size_t size, loff_t *offset) {
     IGNORE_ARG(file);
-    int res = check_valid(size);
+    if (*offset >= disk.layout_size)
+        return 0;
+    ssize_t res = check_valid(*offset, size);
     if(res < 0)
         return res;
-    if (copy_to_user(user_buffer, disk.head, CONFIG_BLOCK_SZ))
+    if (copy_to_user(user_buffer, disk.layout + *offset, res))
         return -EFAULT;
-    FORWARD_HEAD(disk, CONFIG_BLOCK_SZ);
-    INC_READCNT(disk);
-    return CONFIG_BLOCK_SZ;
+    *offset += res;
+    INC_READCNT(disk, res / CONFIG_BLOCK_SZ);
+    return res;
 }
 /**
  * @brief Disk Write
  * 
  * @param file          Ignored
  * @param user_buffer   User space buffer, copy content from
- * @param size          Must equal to Blocksize @CONFIG_BLOCK_SZ
- * @param offset        Ignored
+ * @param size          Multiple of Blocksize @CONFIG_BLOCK_SZ, one copy for all sectors
+ * @param offset        Disk offset, &file->f_pos for write(2), caller's for pwrite(2)
  * @return ssize_t      Bytes have been written
  */
 static ssize_t 
-device_write(struct file *file, const char *user_buffer, size_t size, loff_t *offset) {
-    IGNORE_ARG(offset);
+device_write(struct file *file, const char __user *user_buffer, size_t size, loff_t *offset) {
     IGNORE_ARG(file);
-    int res = check_valid(size);
+    ssize_t res = check_valid(*offset, size);
     if(res < 0)
         return res;
 
-    if (copy_from_user(disk.head, user_buffer, CONFIG_BLOCK_SZ))
+    if (copy_from_user(disk.layout + *offset, user_buffer, res))
         return -EFAULT;
-    FORWARD_HEAD(disk, CONFIG_BLOCK_SZ);
-    INC_WRITECNT(disk);
-    return CONFIG_BLOCK_SZ;
+    *offset += res;
+    INC_WRITECNT(disk, res / CONFIG_BLOCK_SZ);
+    return res;
 }
 /**
- * @brief Disk Seek
+ * @brief Disk Seek, moves the head of this opener only
  * 
- * @param file          Ignored
+ * @param file          Opener, head is file->f_pos
  * @param offset        Aligned to @CONFIG_BLOCK_SZ
- * @param whence        SEEK_CUR, SEEK_SET
+ * @param whence        SEEK_CUR, SEEK_SET, SEEK_END
  * @return loff_t       cur pos
  */
 static loff_t 
 device_seek(struct file *file, loff_t offset, int whence) {
-    IGNORE_ARG(file);
+    loff_t pos;
     if (!IS_ADDR_ALIGN(offset)) {
         kernel_alert("offset %lld must be aligned to block size %d", 
                       offset, CONFIG_BLOCK_SZ);
         return -EINVAL;
     }
-    switch (whence)
-    {
-    case SEEK_SET:
-        SET_HEAD(disk, offset);
-        break;
-    case SEEK_CUR:
-        FORWARD_HEAD(disk, offset);
-        break;
-    default:
-        break;
-    }
-    INC_SEEKCNT(disk);
-    return GET_HEAD_POS(disk);
+    pos = fixed_size_llseek(file, offset, whence, disk.layout_size);
+    if (pos >= 0)
+        INC_SEEKCNT(disk);
+    return pos;
 }
 /**
  * @brief Disk ioctl
@@ -199,9 +199,9 @@ device_seek(struct file *file, loff_t offset, int whence) {
  */
 static long 
 device_ioctl(struct file *file, unsigned int cmd, unsigned long arg){
-    IGNORE_ARG(file);
     int ret;
     struct ddriver_state state;
+    struct ddriver_vclock vc;
     switch (cmd)
     {
     case IOC_REQ_DEVICE_SIZE:                         /* Device Size */
@@ -210,46 +210,66 @@ device_ioctl(struct file *file, unsigned int cmd, unsigned long arg){
             return -EFAULT;
         break;
     case IOC_REQ_DEVICE_STATE:                        /* Device State */
-        state.read_cnt = disk.read_cnt;
-        state.write_cnt = disk.write_cnt;
-        state.seek_cnt = disk.seek_cnt;
+        state.read_cnt = atomic_read(&disk.read_cnt);
+        state.write_cnt = atomic_read(&disk.write_cnt);
+        state.seek_cnt = atomic_read(&disk.seek_cnt);
         ret = copy_to_user((int __user *)arg, &state, sizeof(struct ddriver_state));
         if (ret) 
             return -EFAULT;
         break;
-    case IOC_REQ_DEVICE_RESET:                        /* Reset Device */
-        disk.head = disk.layout;
-        disk.read_cnt = 0;
-        disk.write_cnt = 0;
-        disk.seek_cnt = 0;
+    case IOC_REQ_DEVICE_RESET:                        /* Reset Device, and the head of this opener */
+        vfs_setpos(file, 0, disk.layout_size);
+        atomic_set(&disk.read_cnt, 0);
+        atomic_set(&disk.write_cnt, 0);
+        atomic_set(&disk.seek_cnt, 0);
         break;
     case IOC_REQ_DEVICE_IO_SZ:
         ret = copy_to_user((int __user *)arg, &disk.iounit_size, sizeof(int));
         if (ret) 
             return -EFAULT;
         break;
+    case IOC_REQ_DEVICE_FLUSH:                        /* Flush, in-memory disk, nothing to do */
+        break;
+    case IOC_REQ_DEVICE_VCLOCK:                       /* Virtual Clock, no latency emulation, always zero */
+        memset(&vc, 0, sizeof(struct ddriver_vclock));
+        vc.qdepth = 1;
+        ret = copy_to_user((struct ddriver_vclock __user *)arg, &vc, sizeof(struct ddriver_vclock));
+        if (ret) 
+            return -EFAULT;
+        break;
     default:
         break;
     }
     return 0;
 }
 /**
- * @brief Disk Open
+ * @brief Disk mmap, maps the disk layout for zero-copy access
+ * 
+ * Accesses through the mapping are not counted and share pages with read/write,
+ * the in-memory disk needs no flush
  * 
- * @param inode         Ignored
  * @param file          Ignored
+ * @param vma           User range, vm_pgoff is the page offset in the disk
+ * @return int          state, -EINVAL if the range exceeds the disk
+ */
+static int 
+device_mmap(struct file *file, struct vm_area_struct *vma) {
+    IGNORE_ARG(file);
+    return remap_vmalloc_range(vma, disk.layout, vma->vm_pgoff);
+}
+/**
+ * @brief Disk Open, any number of openers, each starts with its head at 0
+ * 
+ * @param inode         Ignored
+ * @param file          Opener
  * @return int          state
  */
 static int 
 device_open(struct inode *inode, struct file *file) {
     IGNORE_ARG(inode);
-    IGNORE_ARG(file);
     
-    if (disk.open_count) {                            /* If device is open, return busy */
-        return -EBUSY;
-    }
-    RESET_HEAD(disk);                                 /* Everytime close device, reset head */
-    disk.open_count++;
+    file->f_pos = 0;
+    atomic_inc(&disk.open_count);
     try_module_get(THIS_MODULE);
     return 0;
 }
@@ -266,7 +286,7 @@ device_release(struct inode *inode, struct file *file) {
                                                          Without this, the module would not unload. */
     IGNORE_ARG(inode);
     IGNORE_ARG(file);
-    disk.open_count--;
+    atomic_dec(&disk.open_count);
     module_put(THIS_MODULE);
     return 0;
 }
@@ -276,16 +296,29 @@ device_release(struct inode *inode, struct file *file) {
 static int __init 
 ddriver_init(void)
 {
-    int major_num = register_chrdev(0, DEVICE_NAME, &file_ops);   
+    int major_num;
+    if (disk_size < CONFIG_BLOCK_SZ || disk_size > INT_MAX || !IS_ADDR_ALIGN(disk_size)) {
+        kernel_alert("disk_size %lu must be a multiple of %d below 2GiB", disk_size, CONFIG_BLOCK_SZ);
+        return -EINVAL;
+    }
+    disk.layout = vmalloc_user(PAGE_ALIGN(disk_size));  /* Zeroed, and remap_vmalloc_range needs it */
+    if (disk.layout == NULL) {
+        kernel_alert("Can't allocate %lu bytes of disk", disk_size);
+        return -ENOMEM;
+    }
+    disk.layout_size = disk_size;
+
+    major_num = register_chrdev(0, DEVICE_NAME, &file_ops);   
                                                       /* Register an device */
     if (major_num < 0) {                              /* Register fail */
         kernel_alert("Can't register device, ret %d", major_num);
+        vfree(disk.layout);
+        disk.layout = NULL;
         return major_num;
     } 
     else {                                            /* Register success */                                                  
         kernel_info("module loaded with device major number %d", major_num);
         disk.major_num = major_num;
-        memset(disk.layout, 0, CONFIG_DISK_SZ);
         return 0;
     }
     return 0;
@@ -299,6 +332,7 @@ ddriver_exit(void)
     if(major_num != 0){
         unregister_chrdev(major_num, DEVICE_NAME);
     }
+    vfree(disk.layout);
 }
 
 module_init(ddriver_init);
@@ -14,8 +14,18 @@ struct ddriver_state
     int seek_cnt;
 };
 
+struct ddriver_vclock
+{
+    long long time_ns;
+    long long busy_ns;
+    long long nr_reqs;
+    int qdepth;
+};
+
 #define IOC_REQ_DEVICE_SIZE     _IOR(IOC_MAGIC, 0, int)
 #define IOC_REQ_DEVICE_STATE    _IOR(IOC_MAGIC, 1, struct ddriver_state)
 #define IOC_REQ_DEVICE_RESET    _IO(IOC_MAGIC, 2)
 #define IOC_REQ_DEVICE_IO_SZ    _IOR(IOC_MAGIC, 3, int)
+#define IOC_REQ_DEVICE_FLUSH    _IO(IOC_MAGIC, 4)
+#define IOC_REQ_DEVICE_VCLOCK   _IOR(IOC_MAGIC, 5, struct ddriver_vclock)
 #endif
\ No newline at end of file
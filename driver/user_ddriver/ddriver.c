@@ -3,13 +3,16 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include "string.h"
 #include <linux/fs.h>
 #include "ddriver_ctl.h"
+#include "dvolume.h"
 #include "stdio.h"
 #include "errno.h"
 #include <pwd.h>
 #include <time.h>
+#include <pthread.h>
 
 extern int errno;
 
@@ -22,6 +25,9 @@ extern int errno;
 *******************************************************************************/   
 #define DEVICE_NAME   "ddriver"
 #define DEVICE_LOG    "ddriver_log"
+#define DEVICE_MMAP   "DDRIVER_MMAP"                 /* 环境变量非空且不为0时以mmap模式打开 */
+#define DEVICE_VCLOCK "DDRIVER_VCLOCK"               /* 虚拟时钟：未设置时真实睡眠，1只累计设备时间，sync累计并与墙钟同步 */
+#define DEVICE_QDEPTH "DDRIVER_QDEPTH"               /* 虚拟时钟的设备队列深度，默认1 */
 
 #define user_info(fmt, ...)\
 	do {\
@@ -46,6 +52,10 @@ extern int errno;
 
 #define CONFIG_DISK_SZ  (4 * 1024 * 1024)
 #define CONFIG_BLOCK_SZ (512)
+#define CONFIG_MAX_DEVS         (8)                  /* 同时打开的设备数 */
+#define CONFIG_MAX_QUEUES       (64)                 /* 所有设备的队列总数 */
+#define CONFIG_MAX_QDEPTH       (32)
+#define CONFIG_VCLOCK_SLACK_NS  (1000 * 1000)        /* sync模式下设备时间领先墙钟超过1ms才睡眠 */
 /******************************************************************************
 * SECTION: Macro Functions 
 *******************************************************************************/
@@ -53,20 +63,38 @@ extern int errno;
 #define IS_ADDR_ALIGN(addr)     (addr % CONFIG_BLOCK_SZ == 0)
 #define ADDR_ROUND_UP(addr)     ((addr / CONFIG_BLOCK_SZ) * CONFIG_BLOCK_SZ)
 
-#define INC_READCNT(disk)       (disk.read_cnt++)
-#define INC_WRITECNT(disk)      (disk.write_cnt++)
-#define INC_SEEKCNT(disk)       (disk.seek_cnt++)
+#define INC_READCNT(q)          (q->read_cnt++)
+#define INC_WRITECNT(q)         (q->write_cnt++)
+#define INC_SEEKCNT(q)          (q->seek_cnt++)
 
-#define RW_DELAY(disk, rw_ops)  (usleep(disk.rw_ops##_lat * 1000))
+#define RW_DELAY(q, rw_ops)     (emulate_delay(q, q->dev->rw_ops##_lat * 1000))
 /******************************************************************************
 * SECTION: Type definitions
 *******************************************************************************/
+enum vclock_mode
+{
+    VCLOCK_OFF,                                      /* 真实睡眠，同时累计设备时间 */
+    VCLOCK_ON,                                       /* 只累计设备时间，不睡眠 */
+    VCLOCK_SYNC                                      /* 累计设备时间，只在领先墙钟时睡眠 */
+};
+
+struct vclock
+{
+    int       mode;
+    int       qdepth;                                /* 可同时服务的请求数 */
+    long long slot_free[CONFIG_MAX_QDEPTH];          /* 各服务槽空闲的设备时刻(ns) */
+    long long now;                                   /* 最晚完成时刻，即设备时间 */
+    long long busy;                                  /* 服务时间之和 */
+    long long nr_reqs;
+    struct timespec wall_start;                      /* sync模式的墙钟起点 */
+};
+
+/* 设备：一个后备文件，同一文件的多次打开共享同一设备 */
 struct ddriver
 {
-    int  ddriver_fd;                                 /* Disk ddriver_fd */
-    int  read_cnt;
-    int  write_cnt;
-    int  seek_cnt;
+    int  refcnt;                                     /* 打开的队列数，0表示空闲 */
+    dev_t st_dev;                                    /* 后备文件标识 */
+    ino_t st_ino;
     int  read_lat;
     int  write_lat;
     int  seek_lat;
@@ -74,25 +102,42 @@ struct ddriver
     int  major_num;
     int  layout_size;
     int  iounit_size;
+    char *map;                                       /* mmap mode: mapped disk, NULL in file mode */
+    struct vclock vclock;
+    pthread_mutex_t lock;                            /* 保护vclock */
+};
+
+/* 队列：设备的一个硬件队列上下文，有独立的磁盘头与计数，由ddriver_open返回的fd标识 */
+struct ddriver_queue
+{
+    int  ddriver_fd;                                 /* 队列独占的文件描述符，-1表示空闲 */
+    struct ddriver *dev;
+    int  read_cnt;
+    int  write_cnt;
+    int  seek_cnt;
+    off_t pos;                                       /* mmap mode: disk head position */
+    long long clock;                                 /* 队列的设备时刻，即其上一个请求完成的时刻 */
 };
 /******************************************************************************
 * SECTION: Global Variable
 *******************************************************************************/
 /* reference: https://en.wikipedia.org/wiki/Hard_disk_drive_performance_characteristics */
-struct ddriver disk = {
-    .read_cnt    = 0,
-    .write_cnt   = 0,
-    .seek_cnt    = 0,
+const struct ddriver disk = {
+    .refcnt      = 0,
     .read_lat    = 2,       /* 2ms */       
     .write_lat   = 1,       /* 1ms */
     .seek_lat    = 4,       /* 4.17ms per 360 degree */
     .major_num   = 0,
     .track_num   = 100,
     .layout_size = CONFIG_DISK_SZ,
-    .iounit_size = CONFIG_BLOCK_SZ
+    .iounit_size = CONFIG_BLOCK_SZ,
+    .map         = NULL
 };
 
 FILE *debugf = NULL;
+struct ddriver       devs[CONFIG_MAX_DEVS];
+struct ddriver_queue queues[CONFIG_MAX_QUEUES];
+pthread_mutex_t      table_lock = PTHREAD_MUTEX_INITIALIZER;   /* 保护设备与队列表 */
 /******************************************************************************
 * SECTION: Helper Functions
 *******************************************************************************/
@@ -104,61 +149,293 @@ int check_valid(size_t size) {
     return 0;
 }
 
-int emulate_rotate(int fd, off_t start, off_t end) {
-    int bytes_per_track = disk.layout_size / disk.track_num;
-    int lat_per_track = disk.seek_lat;
+/**
+ * @brief 由fd找到队列，调用者须持有table_lock
+ * 
+ * @param fd 
+ * @return struct ddriver_queue* fd未打开时为NULL
+ */
+struct ddriver_queue *queue_find(int fd) {
+    int i;
+    if (fd < 0) {
+        return NULL;
+    }
+    for (i = 0; i < CONFIG_MAX_QUEUES; i++) {
+        if (queues[i].dev != NULL && queues[i].ddriver_fd == fd)
+            return &queues[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief 由fd找到队列，查找期间持有table_lock，不与其他线程的open/close交错
+ * 
+ * @param fd 
+ * @return struct ddriver_queue* fd未打开时为NULL
+ */
+struct ddriver_queue *queue_get(int fd) {
+    struct ddriver_queue *q;
+    pthread_mutex_lock(&table_lock);
+    q = queue_find(fd);
+    pthread_mutex_unlock(&table_lock);
+    return q;
+}
+
+/**
+ * @brief 模拟队列q上一次耗时us微秒的设备操作
+ * 
+ * 请求在队列的时刻到达，同一队列的请求依次执行；
+ * 设备最多同时服务qdepth个请求，不同队列的请求可以重叠。
+ * 优先选择到达时已空闲且空闲最晚的服务槽，避免后到达的队列被先前的空闲时段挤到后面；
+ * 设备时间为所有请求的最晚完成时刻
+ * 
+ * @param q 
+ * @param us 
+ */
+void emulate_delay(struct ddriver_queue *q, long us) {
+    struct vclock *vc = &q->dev->vclock;
+    long long service = us * 1000LL;
+    long long arrive = q->clock, start, wall, lead = 0;
+    struct timespec ts;
+    int i, k = -1;
+
+    if (vc->mode == VCLOCK_OFF) {
+        usleep(us);
+    }
+
+    pthread_mutex_lock(&q->dev->lock);
+    for (i = 0; i < vc->qdepth; i++) {
+        if (vc->slot_free[i] <= arrive && (k < 0 || vc->slot_free[i] > vc->slot_free[k]))
+            k = i;
+    }
+    if (k < 0) {                                     /* 全忙，等最早空闲的槽 */
+        for (k = 0, i = 1; i < vc->qdepth; i++) {
+            if (vc->slot_free[i] < vc->slot_free[k])
+                k = i;
+        }
+    }
+    start = arrive > vc->slot_free[k] ? arrive : vc->slot_free[k];
+    vc->slot_free[k] = start + service;
+    q->clock         = start + service;
+    if (q->clock > vc->now)
+        vc->now = q->clock;
+    vc->busy += service;
+    vc->nr_reqs++;
+
+    if (vc->mode == VCLOCK_SYNC) {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        wall = (ts.tv_sec - vc->wall_start.tv_sec) * 1000000000LL
+             + (ts.tv_nsec - vc->wall_start.tv_nsec);
+        lead = vc->now - wall;
+    }
+    pthread_mutex_unlock(&q->dev->lock);
+
+    if (lead > CONFIG_VCLOCK_SLACK_NS)
+        usleep(lead / 1000);
+}
+
+/**
+ * @brief 队列的设备时刻，即其上一个请求完成的时刻(ns)
+ * 
+ * @param fd 
+ * @return long long fd未打开时为0
+ */
+long long ddriver_queue_clock(int fd) {
+    struct ddriver_queue *q = queue_get(fd);
+    long long clock;
+    if (q == NULL)
+        return 0;
+    pthread_mutex_lock(&q->dev->lock);
+    clock = q->clock;
+    pthread_mutex_unlock(&q->dev->lock);
+    return clock;
+}
+
+/**
+ * @brief 设置队列下一个请求的到达时刻(ns)
+ * 
+ * 卷的成员各有一个队列，卷把成员请求的到达时刻设为卷上一个请求完成的时刻，
+ * 单个串行调用者的请求因此在各成员间依次执行，而不是各自从成员的空闲时刻开始
+ * 
+ * @param fd 
+ * @param clock 
+ */
+void ddriver_queue_set_clock(int fd, long long clock) {
+    struct ddriver_queue *q = queue_get(fd);
+    if (q == NULL)
+        return;
+    pthread_mutex_lock(&q->dev->lock);
+    q->clock = clock;
+    pthread_mutex_unlock(&q->dev->lock);
+}
+
+void vclock_init(struct vclock *vc) {
+    char *mode   = getenv(DEVICE_VCLOCK);
+    char *qdepth = getenv(DEVICE_QDEPTH);
+
+    memset(vc, 0, sizeof(struct vclock));
+    if (mode == NULL || mode[0] == '\0' || strcmp(mode, "0") == 0)
+        vc->mode = VCLOCK_OFF;
+    else if (strcmp(mode, "sync") == 0)
+        vc->mode = VCLOCK_SYNC;
+    else
+        vc->mode = VCLOCK_ON;
+
+    vc->qdepth = qdepth != NULL ? atoi(qdepth) : 1;
+    if (vc->qdepth < 1)
+        vc->qdepth = 1;
+    if (vc->qdepth > CONFIG_MAX_QDEPTH)
+        vc->qdepth = CONFIG_MAX_QDEPTH;
+    clock_gettime(CLOCK_MONOTONIC, &vc->wall_start);
+}
+
+/**
+ * @brief 清零设备的虚拟时钟与其所有队列的时刻
+ * 
+ * @param dev 
+ */
+void vclock_reset(struct ddriver *dev) {
+    int i;
+    pthread_mutex_lock(&dev->lock);
+    vclock_init(&dev->vclock);
+    for (i = 0; i < CONFIG_MAX_QUEUES; i++) {
+        if (queues[i].dev == dev)
+            queues[i].clock = 0;
+    }
+    pthread_mutex_unlock(&dev->lock);
+}
+
+int emulate_rotate(struct ddriver_queue *q, off_t start, off_t end) {
+    int bytes_per_track = q->dev->layout_size / q->dev->track_num;
+    int lat_per_track = q->dev->seek_lat;
     int distance = abs(end - start) % bytes_per_track; 
     
     if (distance == 0) {
         return 0;
     }
 
-    usleep(distance * lat_per_track / bytes_per_track * 1000);
+    emulate_delay(q, distance * lat_per_track / bytes_per_track * 1000);
     return 0;
 }
+int is_mmap_mode() {
+    char *env = getenv(DEVICE_MMAP);
+    return env != NULL && env[0] != '\0' && strcmp(env, "0") != 0;
+}
+
+/**
+ * @brief 找到后备文件对应的已打开设备，没有则新建
+ * 
+ * @param fd 后备文件的文件描述符，新建设备时用于映射
+ * @param st 后备文件状态
+ * @return struct ddriver* 设备已满时为NULL
+ */
+struct ddriver *device_get(int fd, struct stat *st) {
+    struct ddriver *dev = NULL;
+    int i;
+
+    for (i = 0; i < CONFIG_MAX_DEVS; i++) {
+        if (devs[i].refcnt > 0 && devs[i].st_dev == st->st_dev && devs[i].st_ino == st->st_ino)
+            return &devs[i];
+        if (devs[i].refcnt == 0 && dev == NULL)
+            dev = &devs[i];
+    }
+    if (dev == NULL) {
+        return NULL;
+    }
+
+    *dev = disk;
+    dev->st_dev = st->st_dev;
+    dev->st_ino = st->st_ino;
+    pthread_mutex_init(&dev->lock, NULL);
+    vclock_init(&dev->vclock);
+
+    /* mmap模式：读写变为内存拷贝，映射失败时退回文件读写；映射在设备所有队列关闭前一直有效 */
+    if (is_mmap_mode()) {
+        dev->map = mmap(NULL, CONFIG_DISK_SZ, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (dev->map == MAP_FAILED) {
+            user_alert("mmap failed: %s, fall back to file io", strerror(errno));
+            dev->map = NULL;
+        }
+    }
+    return dev;
+}
 /******************************************************************************
 * SECTION: Global Function Implementation
 *******************************************************************************/
 /**
  * @brief 打开驱动
  * 
+ * path为任意磁盘文件路径，不存在时创建。每次打开得到设备的一个新队列：
+ * 再次打开同一文件时与已有队列共享设备（映射与虚拟时钟），但磁盘头与读写计数各自独立。
+ * path为卷描述（raid0:、raid1:开头，见dvolume.h）时打开由多个设备组成的卷
+ * 
  * @return int 文件描述符
  */
 int ddriver_open(char *path) {
-    int fd, ret = 0;
-    char device_path[128] = {0};
+    int fd, i, ret = 0;
     char log_path[128] = {0};
-    
-    sprintf(device_path, "%s/" DEVICE_NAME, getpwuid(getuid())->pw_dir);
-    sprintf(log_path, "%s/" DEVICE_LOG, getpwuid(getuid())->pw_dir);
-    
-    if (strcmp(device_path, path) != 0) {
-        user_panic("wrong path [%s], should be [%s]", path, device_path);
-        return -1;
+    struct stat st;
+    struct ddriver *dev;
+    struct ddriver_queue *q = NULL;
+
+    if (dvolume_is_spec(path)) {
+        return dvolume_open(path);
     }
 
-    if (access(device_path, F_OK) == 0) {
-        fd = open(device_path, O_RDWR);
+    pthread_mutex_lock(&table_lock);
+    for (i = 0; i < CONFIG_MAX_QUEUES; i++) {
+        if (queues[i].dev == NULL) {
+            q = &queues[i];
+            break;
+        }
     }
-    else {
-        fd = open(device_path, O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (q == NULL) {
+        pthread_mutex_unlock(&table_lock);
+        user_panic("too many queues, at most %d", CONFIG_MAX_QUEUES);
+        return -EMFILE;
     }
+
+    if (debugf == NULL) {
+        sprintf(log_path, "%s/" DEVICE_LOG, getpwuid(getuid())->pw_dir);
+        debugf = fopen(log_path, "w+");
+        if (debugf == NULL) {
+            pthread_mutex_unlock(&table_lock);
+            user_panic("can't init log: %s", log_path);
+            return -1;
+        }
+    }
+
+    fd = open(path, O_CREAT | O_RDWR, 0644);
     if (fd < 0) {
-        user_panic("can't open device: %d", fd);
+        pthread_mutex_unlock(&table_lock);
+        user_panic("can't open device [%s]: %s", path, strerror(errno));
         return fd;
     }
     ret = posix_fallocate(fd, 0, CONFIG_DISK_SZ);
-    if (ret < 0) {
+    if (ret != 0 || fstat(fd, &st) < 0) {
+        close(fd);
+        pthread_mutex_unlock(&table_lock);
         user_panic("low space");
-        return ret;
+        return -ENOSPC;
     }
 
-    debugf = fopen(log_path, "w+");
-    if (debugf == NULL) {
-        user_panic("can't init log: %s", log_path);
-        return -1;
+    dev = device_get(fd, &st);
+    if (dev == NULL) {
+        close(fd);
+        pthread_mutex_unlock(&table_lock);
+        user_panic("too many devices, at most %d", CONFIG_MAX_DEVS);
+        return -EMFILE;
     }
+    dev->refcnt++;
 
+    memset(q, 0, sizeof(struct ddriver_queue));
+    q->ddriver_fd = fd;
+    q->dev        = dev;
+    /* 新队列从设备当前时刻开始，否则其第一个请求被当作在设备时刻0到达 */
+    pthread_mutex_lock(&dev->lock);
+    q->clock      = dev->vclock.now;
+    pthread_mutex_unlock(&dev->lock);
+    pthread_mutex_unlock(&table_lock);
     return fd;
 }
 /**
@@ -168,7 +445,38 @@ int ddriver_open(char *path) {
  * @return int 
  */
 int ddriver_close(int fd) {
-    return close(fd) && fclose(debugf);
+    struct ddriver_queue *q;
+    struct ddriver *dev;
+    int i, ret;
+
+    if (dvolume_owns(fd)) {
+        return dvolume_close(fd);
+    }
+
+    pthread_mutex_lock(&table_lock);
+    q = queue_find(fd);
+    if (q == NULL) {
+        pthread_mutex_unlock(&table_lock);
+        return -EBADF;
+    }
+    dev = q->dev;
+    q->dev = NULL;
+    if (--dev->refcnt == 0) {
+        if (dev->map != NULL) {
+            munmap(dev->map, CONFIG_DISK_SZ);
+            dev->map = NULL;
+        }
+        pthread_mutex_destroy(&dev->lock);
+    }
+    ret = close(fd);
+
+    for (i = 0; i < CONFIG_MAX_DEVS && devs[i].refcnt == 0; i++);
+    if (i == CONFIG_MAX_DEVS && debugf != NULL) {
+        fclose(debugf);
+        debugf = NULL;
+    }
+    pthread_mutex_unlock(&table_lock);
+    return ret;
 }
 /**
  * @brief 磁盘头SEEK
@@ -179,23 +487,42 @@ int ddriver_close(int fd) {
  * @return int 
  */
 int ddriver_seek(int fd, off_t offset, int whence){
+    struct ddriver_queue *q = queue_get(fd);
     int ret = 0;
     int cur = 0;
 
+    if (dvolume_owns(fd)) {
+        return dvolume_seek(fd, offset, whence);
+    }
+    if (q == NULL) {
+        return -EBADF;
+    }
     if (!IS_ADDR_ALIGN(offset)) {
         user_alert("offset %ld must be aligned to block size %d", 
                       offset, CONFIG_BLOCK_SZ);
         return -EINVAL;
     }
 
-    INC_SEEKCNT(disk);
-    cur = lseek(fd, 0, SEEK_CUR);
+    INC_SEEKCNT(q);
+    if (q->dev->map != NULL) {
+        cur = q->pos;
+        ret = whence == SEEK_CUR ? cur + offset :
+              whence == SEEK_END ? q->dev->layout_size + offset : offset;
+        if (ret < 0 || ret > q->dev->layout_size) {
+            user_panic("seek error: offset %ld out of disk", offset);
+            return -EINVAL;
+        }
+        q->pos = ret;
+        emulate_rotate(q, cur, ret);
+        return ret;
+    }
+    cur = lseek(fd, 0, SEEK_CUR);                     /* 每个队列独占fd，文件偏移即队列的磁盘头 */
     ret = lseek(fd, offset, whence);
     if (ret < 0) {
         user_panic("seek error: %s", strerror(errno));
         return ret;
     }
-    emulate_rotate(fd, cur, ret);
+    emulate_rotate(q, cur, ret);
     return ret;
 }
 /**
@@ -207,14 +534,28 @@ int ddriver_seek(int fd, off_t offset, int whence){
  * @return int 
  */
 int ddriver_write(int fd, char *buf, size_t size){
-    int res = check_valid(size);
+    struct ddriver_queue *q = queue_get(fd);
+    int res;
+    if (dvolume_owns(fd))
+        return dvolume_write(fd, buf, size);
+    res = check_valid(size);
     if(res < 0)
         return res;
+    if (q == NULL)
+        return -EBADF;
         
-    RW_DELAY(disk, write);
-    write(fd, buf, size);
+    RW_DELAY(q, write);
+    if (q->dev->map != NULL) {
+        if (q->pos + size > q->dev->layout_size)
+            return -EIO;
+        memcpy(q->dev->map + q->pos, buf, size);
+        q->pos += size;
+    }
+    else {
+        write(fd, buf, size);
+    }
 
-    INC_WRITECNT(disk);
+    INC_WRITECNT(q);
     return CONFIG_BLOCK_SZ;
 }
 /**
@@ -226,14 +567,28 @@ int ddriver_write(int fd, char *buf, size_t size){
  * @return int 
  */
 int ddriver_read(int fd, char *buf, size_t size){
-    int res = check_valid(size);
+    struct ddriver_queue *q = queue_get(fd);
+    int res;
+    if (dvolume_owns(fd))
+        return dvolume_read(fd, buf, size);
+    res = check_valid(size);
     if(res < 0)
         return res;
+    if (q == NULL)
+        return -EBADF;
 
-    RW_DELAY(disk, read);
-    read(fd, buf, size);
+    RW_DELAY(q, read);
+    if (q->dev->map != NULL) {
+        if (q->pos + size > q->dev->layout_size)
+            return -EIO;
+        memcpy(buf, q->dev->map + q->pos, size);
+        q->pos += size;
+    }
+    else {
+        read(fd, buf, size);
+    }
 
-    INC_READCNT(disk);
+    INC_READCNT(q);
     return CONFIG_BLOCK_SZ;
 }
 /**
@@ -245,16 +600,22 @@ int ddriver_read(int fd, char *buf, size_t size){
  * @return int 
  */
 int ddriver_ioctl(int fd, unsigned long cmd, void *arg){
+    struct ddriver_queue *q = queue_get(fd);
     struct ddriver_state state;
+    struct ddriver_vclock vc;
+    if (dvolume_owns(fd))
+        return dvolume_ioctl(fd, cmd, arg);
+    if (q == NULL)
+        return -EBADF;
     switch (cmd)
     {
     case IOC_REQ_DEVICE_SIZE:                         /* Device Size */
-        memcpy(arg, &disk.layout_size, sizeof(int));
+        memcpy(arg, &q->dev->layout_size, sizeof(int));
         break;
-    case IOC_REQ_DEVICE_STATE:                        /* Device State */
-        state.read_cnt = disk.read_cnt;
-        state.write_cnt = disk.write_cnt;
-        state.seek_cnt = disk.seek_cnt;
+    case IOC_REQ_DEVICE_STATE:                        /* Queue State */
+        state.read_cnt = q->read_cnt;
+        state.write_cnt = q->write_cnt;
+        state.seek_cnt = q->seek_cnt;
         memcpy(arg, &state, sizeof(struct ddriver_state));
         break;
     case IOC_REQ_DEVICE_RESET:                        /* Reset Device */
@@ -265,15 +626,52 @@ int ddriver_ioctl(int fd, unsigned long cmd, void *arg){
             write(fd, buf, 4096);
         }
         lseek(fd, 0, SEEK_SET);
-        disk.read_cnt = 0;
-        disk.write_cnt = 0;
-        disk.seek_cnt = 0;
+        q->pos = 0;                                   /* MAP_SHARED与文件内容一致，无需另行清零 */
+        vclock_reset(q->dev);
+        q->read_cnt = 0;
+        q->write_cnt = 0;
+        q->seek_cnt = 0;
         break;
     case IOC_REQ_DEVICE_IO_SZ:
-        memcpy(arg, &disk.iounit_size, sizeof(int));
+        memcpy(arg, &q->dev->iounit_size, sizeof(int));
+        break;
+    case IOC_REQ_DEVICE_VCLOCK:                       /* Virtual Clock */
+        pthread_mutex_lock(&q->dev->lock);
+        vc.time_ns = q->dev->vclock.now;
+        vc.busy_ns = q->dev->vclock.busy;
+        vc.nr_reqs = q->dev->vclock.nr_reqs;
+        vc.qdepth  = q->dev->vclock.qdepth;
+        pthread_mutex_unlock(&q->dev->lock);
+        memcpy(arg, &vc, sizeof(struct ddriver_vclock));
+        break;
+    case IOC_REQ_DEVICE_FLUSH:                        /* Flush to backing file */
+        if (q->dev->map != NULL ? msync(q->dev->map, CONFIG_DISK_SZ, MS_SYNC) : fsync(fd)) {
+            user_panic("flush error: %s", strerror(errno));
+            return -EIO;
+        }
         break;
     default:
         break;
     }
     return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief 返回已映射磁盘区间的直接指针，供零拷贝访问
+ * 
+ * 仅mmap模式可用，卷不连续映射，总是返回NULL。经指针的访问不计入读写次数，也不模拟延迟；
+ * 修改需经IOC_REQ_DEVICE_FLUSH才保证写回后备文件
+ * 
+ * @param fd 
+ * @param offset 区间起点，需与设备IO单位对齐
+ * @param size 区间大小
+ * @return char* 非mmap模式或区间越界时为NULL
+ */
+char *ddriver_map(int fd, off_t offset, size_t size) {
+    struct ddriver_queue *q = queue_get(fd);
+    if (q == NULL || q->dev->map == NULL || !IS_ADDR_ALIGN(offset) || offset < 0 ||
+        offset + size > q->dev->layout_size) {
+        return NULL;
+    }
+    return q->dev->map + offset;
+}
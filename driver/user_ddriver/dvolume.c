@@ -0,0 +1,455 @@
+#include "stdio.h"
+#include "stdlib.h"
+#include <unistd.h>
+#include "string.h"
+#include "errno.h"
+#include <pthread.h>
+#include "include/ddriver.h"
+#include "dvolume.h"
+
+#define USER_PANIC    "PANIC: "
+/******************************************************************************
+* SECTION: Macro definitions
+*******************************************************************************/   
+#define volume_panic(fmt, ...)\
+    do {\
+        printf(USER_PANIC  " dvolume " fmt "\n", ##__VA_ARGS__);\
+    } while (0)\
+
+#define CONFIG_MAX_VOLUMES      (4)
+#define CONFIG_MAX_MEMBERS      (8)
+#define CONFIG_MAX_SPEC         (1024)
+#define CONFIG_STRIPE_SZ        (64 * 1024)           /* raid0默认条带大小 */
+/******************************************************************************
+* SECTION: Type definitions
+*******************************************************************************/
+enum dvolume_level
+{
+    DVOLUME_LEVEL_RAID0,
+    DVOLUME_LEVEL_RAID1
+};
+
+struct dvolume
+{
+    int   fd;                                        /* 卷句柄，由dup第一个成员的fd得到以保证唯一，-1表示空闲 */
+    int   level;
+    int   nr_members;
+    int   members[CONFIG_MAX_MEMBERS];               /* 成员设备的fd */
+    off_t member_pos[CONFIG_MAX_MEMBERS];            /* 成员的磁盘头位置，-1表示未知，已在目标位置时不再seek */
+    off_t stripe;                                    /* raid0条带大小 */
+    int   layout_size;
+    int   iounit_size;
+    off_t pos;                                       /* 卷的逻辑磁盘头 */
+    long long clock;                                 /* 卷上一个请求完成的设备时刻，即下一个成员请求的到达时刻 */
+    pthread_mutex_t lock;                            /* 串行化卷上的操作 */
+};
+/******************************************************************************
+* SECTION: Global Variable
+*******************************************************************************/
+struct dvolume  volumes[CONFIG_MAX_VOLUMES] = {
+    [0 ... CONFIG_MAX_VOLUMES - 1] = { .fd = -1 }
+};
+pthread_mutex_t volume_lock = PTHREAD_MUTEX_INITIALIZER;   /* 保护卷表 */
+/******************************************************************************
+* SECTION: Helper Functions
+*******************************************************************************/
+struct dvolume *volume_get(int fd) {
+    int i;
+    if (fd < 0) {
+        return NULL;
+    }
+    for (i = 0; i < CONFIG_MAX_VOLUMES; i++) {
+        if (volumes[i].fd == fd)
+            return &volumes[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief 在成员m的off处读写一个IO单位，磁盘头不在off时先seek
+ * 
+ * 请求在卷的时刻到达成员，与卷上的前一个请求串行
+ * 
+ * @param v 
+ * @param m 成员下标
+ * @param off 成员内偏移
+ * @param buf 
+ * @param size 
+ * @param is_write 
+ * @param done 取该请求与done中较晚的完成时刻
+ * @return int 
+ */
+int member_io(struct dvolume *v, int m, off_t off, char *buf, size_t size, int is_write,
+              long long *done) {
+    long long end;
+    int ret;
+    ddriver_queue_set_clock(v->members[m], v->clock);
+    if (v->member_pos[m] != off) {
+        ret = ddriver_seek(v->members[m], off, SEEK_SET);
+        if (ret < 0) {
+            v->member_pos[m] = -1;
+            return ret;
+        }
+    }
+    ret = is_write ? ddriver_write(v->members[m], buf, size) :
+                     ddriver_read(v->members[m], buf, size);
+    v->member_pos[m] = ret < 0 ? -1 : off + size;
+    end = ddriver_queue_clock(v->members[m]);
+    if (end > *done) {
+        *done = end;
+    }
+    return ret;
+}
+
+/**
+ * @brief 为raid1的读选择镜像
+ * 
+ * 优先选择磁盘头已在off处的镜像（顺序读沿用同一镜像，无需寻道）；
+ * 其次选择负载最轻的镜像，即虚拟时钟上设备时间最小者；负载相同时选择磁盘头最近者
+ * 
+ * @param v 
+ * @param off 
+ * @return int 成员下标
+ */
+int mirror_pick(struct dvolume *v, off_t off) {
+    struct ddriver_vclock vc;
+    long long load, best_load = 0;
+    off_t dist, best_dist = 0;
+    int at_head, best_at_head = 0;
+    int m, best = -1;
+
+    for (m = 0; m < v->nr_members; m++) {
+        at_head = v->member_pos[m] == off;
+        ddriver_ioctl(v->members[m], IOC_REQ_DEVICE_VCLOCK, &vc);
+        load = vc.time_ns;
+        dist = v->member_pos[m] < 0 ? v->layout_size :
+               v->member_pos[m] > off ? v->member_pos[m] - off : off - v->member_pos[m];
+        if (best < 0 || at_head > best_at_head ||
+            (at_head == best_at_head && (load < best_load ||
+                                         (load == best_load && dist < best_dist)))) {
+            best = m;
+            best_at_head = at_head;
+            best_load = load;
+            best_dist = dist;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief 解析条带大小，支持k、m后缀，其后须紧跟':'
+ * 
+ * 数字后不是':'时不是条带大小，而是以数字开头的成员路径，如raid0:1.img,2.img
+ * 
+ * @param str 
+ * @param end 条带大小之后的成员列表
+ * @return off_t 不是条带大小时为-1
+ */
+off_t parse_stripe(char *str, char **end) {
+    char *cur;
+    off_t sz = strtol(str, &cur, 10);
+    if (cur == str) {
+        return -1;
+    }
+    if (*cur == 'k' || *cur == 'K') {
+        sz *= 1024;
+        cur++;
+    }
+    else if (*cur == 'm' || *cur == 'M') {
+        sz *= 1024 * 1024;
+        cur++;
+    }
+    if (*cur != ':') {
+        return -1;
+    }
+    *end = cur + 1;
+    return sz;
+}
+
+void members_close(int *members, int nr_members) {
+    int i;
+    for (i = 0; i < nr_members; i++) {
+        ddriver_close(members[i]);
+    }
+}
+/******************************************************************************
+* SECTION: Global Function Implementation
+*******************************************************************************/
+int dvolume_is_spec(const char *path) {
+    return strncmp(path, DVOLUME_RAID0, strlen(DVOLUME_RAID0)) == 0 ||
+           strncmp(path, DVOLUME_RAID1, strlen(DVOLUME_RAID1)) == 0;
+}
+
+int dvolume_owns(int fd) {
+    return volume_get(fd) != NULL;
+}
+
+/**
+ * @brief 按描述打开卷，依次打开各成员设备
+ * 
+ * @param spec 卷描述，见dvolume.h
+ * @return int 卷句柄
+ */
+int dvolume_open(const char *spec) {
+    char  buf[CONFIG_MAX_SPEC];
+    char *paths, *path, *save;
+    int   members[CONFIG_MAX_MEMBERS];
+    int   nr_members = 0;
+    int   level, i, fd, sz_disk, sz_io, size = 0, io = 0;
+    off_t stripe = CONFIG_STRIPE_SZ;
+    struct dvolume *v = NULL;
+
+    if (strlen(spec) >= CONFIG_MAX_SPEC) {
+        volume_panic("spec too long");
+        return -EINVAL;
+    }
+    strcpy(buf, spec);
+    if (strncmp(buf, DVOLUME_RAID0, strlen(DVOLUME_RAID0)) == 0) {
+        level = DVOLUME_LEVEL_RAID0;
+        paths = buf + strlen(DVOLUME_RAID0);
+        stripe = parse_stripe(paths, &paths);     /* 未给出条带大小时paths不变 */
+        if (stripe < 0) {
+            stripe = CONFIG_STRIPE_SZ;
+        }
+    }
+    else {
+        level = DVOLUME_LEVEL_RAID1;
+        paths = buf + strlen(DVOLUME_RAID1);
+    }
+
+    for (path = strtok_r(paths, ",", &save); path != NULL; path = strtok_r(NULL, ",", &save)) {
+        if (nr_members == CONFIG_MAX_MEMBERS || dvolume_is_spec(path)) {
+            members_close(members, nr_members);
+            volume_panic("bad member [%s], at most %d plain devices", path, CONFIG_MAX_MEMBERS);
+            return -EINVAL;
+        }
+        fd = ddriver_open(path);
+        if (fd < 0) {
+            members_close(members, nr_members);
+            return fd;
+        }
+        members[nr_members++] = fd;
+        ddriver_ioctl(fd, IOC_REQ_DEVICE_SIZE, &sz_disk);
+        ddriver_ioctl(fd, IOC_REQ_DEVICE_IO_SZ, &sz_io);
+        if (io != 0 && sz_io != io) {
+            members_close(members, nr_members);
+            volume_panic("member [%s] io size %d differs from %d", path, sz_io, io);
+            return -EINVAL;
+        }
+        io   = sz_io;
+        size = size == 0 || sz_disk < size ? sz_disk : size;    /* 以最小的成员为准 */
+    }
+    if (nr_members == 0) {
+        volume_panic("no member in [%s]", spec);
+        return -EINVAL;
+    }
+    if (level == DVOLUME_LEVEL_RAID0 && (stripe <= 0 || stripe % io != 0 || stripe > size)) {
+        members_close(members, nr_members);
+        volume_panic("stripe size %ld must be a multiple of %d and fit in a member", stripe, io);
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&volume_lock);
+    for (i = 0; i < CONFIG_MAX_VOLUMES; i++) {
+        if (volumes[i].fd < 0) {
+            v = &volumes[i];
+            break;
+        }
+    }
+    fd = v == NULL ? -1 : dup(members[0]);
+    if (fd < 0) {
+        pthread_mutex_unlock(&volume_lock);
+        members_close(members, nr_members);
+        volume_panic("too many volumes, at most %d", CONFIG_MAX_VOLUMES);
+        return -EMFILE;
+    }
+
+    memset(v, 0, sizeof(struct dvolume));
+    v->level       = level;
+    v->nr_members  = nr_members;
+    v->stripe      = stripe;
+    v->iounit_size = io;
+    v->layout_size = level == DVOLUME_LEVEL_RAID0 ? (size / stripe) * stripe * nr_members : size;
+    for (i = 0; i < nr_members; i++) {
+        v->members[i]    = members[i];
+        v->member_pos[i] = -1;
+    }
+    pthread_mutex_init(&v->lock, NULL);
+    v->fd = fd;
+    pthread_mutex_unlock(&volume_lock);
+    return fd;
+}
+
+int dvolume_close(int fd) {
+    struct dvolume *v;
+    int ret;
+
+    pthread_mutex_lock(&volume_lock);
+    v = volume_get(fd);
+    if (v == NULL) {
+        pthread_mutex_unlock(&volume_lock);
+        return -EBADF;
+    }
+    v->fd = -1;
+    pthread_mutex_unlock(&volume_lock);
+
+    members_close(v->members, v->nr_members);
+    pthread_mutex_destroy(&v->lock);
+    ret = close(fd);
+    return ret;
+}
+
+/**
+ * @brief 移动卷的逻辑磁盘头，成员的寻道推迟到读写时按需进行
+ * 
+ * @param fd 
+ * @param offset 
+ * @param whence 
+ * @return int 
+ */
+int dvolume_seek(int fd, off_t offset, int whence) {
+    struct dvolume *v = volume_get(fd);
+    off_t pos;
+
+    if (v == NULL) {
+        return -EBADF;
+    }
+    pthread_mutex_lock(&v->lock);
+    pos = whence == SEEK_CUR ? v->pos + offset :
+          whence == SEEK_END ? v->layout_size + offset : offset;
+    if (pos % v->iounit_size != 0 || pos < 0 || pos > v->layout_size) {
+        pthread_mutex_unlock(&v->lock);
+        volume_panic("seek error: offset %ld", offset);
+        return -EINVAL;
+    }
+    v->pos = pos;
+    pthread_mutex_unlock(&v->lock);
+    return pos;
+}
+
+/**
+ * @brief 在逻辑磁盘头处读写一个IO单位
+ * 
+ * raid0：第s个条带位于第s % N个成员的第s / N个条带；
+ * raid1：写入所有镜像，读取由mirror_pick选择镜像
+ * 
+ * @param v 
+ * @param buf 
+ * @param size 
+ * @param is_write 
+ * @return int 
+ */
+int volume_io(struct dvolume *v, char *buf, size_t size, int is_write) {
+    off_t s, off;
+    long long done;
+    int m, ret = 0;
+
+    if (size != v->iounit_size) {
+        volume_panic("io size %ld should align to %d", size, v->iounit_size);
+        return -EIO;
+    }
+    pthread_mutex_lock(&v->lock);
+    if (v->pos + size > v->layout_size) {
+        pthread_mutex_unlock(&v->lock);
+        return -EIO;
+    }
+    done = v->clock;
+    if (v->level == DVOLUME_LEVEL_RAID0) {
+        s   = v->pos / v->stripe;
+        off = (s / v->nr_members) * v->stripe + v->pos % v->stripe;
+        ret = member_io(v, s % v->nr_members, off, buf, size, is_write, &done);
+    }
+    else if (is_write) {                             /* 镜像写同时到达各成员，最晚者完成时整个写完成 */
+        for (m = 0; m < v->nr_members && ret >= 0; m++) {
+            ret = member_io(v, m, v->pos, buf, size, 1, &done);
+        }
+    }
+    else {
+        ret = member_io(v, mirror_pick(v, v->pos), v->pos, buf, size, 0, &done);
+    }
+    v->clock = done;
+    if (ret >= 0) {
+        v->pos += size;
+    }
+    pthread_mutex_unlock(&v->lock);
+    return ret;
+}
+
+int dvolume_write(int fd, char *buf, size_t size) {
+    struct dvolume *v = volume_get(fd);
+    return v == NULL ? -EBADF : volume_io(v, buf, size, 1);
+}
+
+int dvolume_read(int fd, char *buf, size_t size) {
+    struct dvolume *v = volume_get(fd);
+    return v == NULL ? -EBADF : volume_io(v, buf, size, 0);
+}
+
+/**
+ * @brief 卷的IO控制
+ * 
+ * 读写与寻道计数为各成员之和（raid1的一次写计入每个镜像）；
+ * 设备时间取成员中最大者，忙碌时间与请求数取和；
+ * 同一卷上的请求依次到达成员，只有多个调用者各自打开卷并发读写时成员才并行工作
+ * 
+ * @param fd 
+ * @param cmd 
+ * @param arg 
+ * @return int 
+ */
+int dvolume_ioctl(int fd, unsigned long cmd, void *arg) {
+    struct dvolume *v = volume_get(fd);
+    struct ddriver_state state, sum = {0};
+    struct ddriver_vclock vc, vsum = {0};
+    int m, ret = 0;
+
+    if (v == NULL) {
+        return -EBADF;
+    }
+    pthread_mutex_lock(&v->lock);
+    switch (cmd)
+    {
+    case IOC_REQ_DEVICE_SIZE:                         /* Volume Size */
+        memcpy(arg, &v->layout_size, sizeof(int));
+        break;
+    case IOC_REQ_DEVICE_STATE:                        /* Sum of Member States */
+        for (m = 0; m < v->nr_members; m++) {
+            ddriver_ioctl(v->members[m], IOC_REQ_DEVICE_STATE, &state);
+            sum.read_cnt  += state.read_cnt;
+            sum.write_cnt += state.write_cnt;
+            sum.seek_cnt  += state.seek_cnt;
+        }
+        memcpy(arg, &sum, sizeof(struct ddriver_state));
+        break;
+    case IOC_REQ_DEVICE_RESET:                        /* Reset Members */
+        for (m = 0; m < v->nr_members; m++) {
+            ddriver_ioctl(v->members[m], IOC_REQ_DEVICE_RESET, NULL);
+            v->member_pos[m] = 0;
+        }
+        v->pos   = 0;
+        v->clock = 0;
+        break;
+    case IOC_REQ_DEVICE_IO_SZ:
+        memcpy(arg, &v->iounit_size, sizeof(int));
+        break;
+    case IOC_REQ_DEVICE_VCLOCK:                       /* Virtual Clock */
+        for (m = 0; m < v->nr_members; m++) {
+            ddriver_ioctl(v->members[m], IOC_REQ_DEVICE_VCLOCK, &vc);
+            vsum.time_ns  = vc.time_ns > vsum.time_ns ? vc.time_ns : vsum.time_ns;
+            vsum.busy_ns += vc.busy_ns;
+            vsum.nr_reqs += vc.nr_reqs;
+            vsum.qdepth  += vc.qdepth;
+        }
+        memcpy(arg, &vsum, sizeof(struct ddriver_vclock));
+        break;
+    case IOC_REQ_DEVICE_FLUSH:                        /* Flush Members */
+        for (m = 0; m < v->nr_members && ret == 0; m++) {
+            ret = ddriver_ioctl(v->members[m], IOC_REQ_DEVICE_FLUSH, NULL);
+        }
+        break;
+    default:
+        break;
+    }
+    pthread_mutex_unlock(&v->lock);
+    return ret;
+}
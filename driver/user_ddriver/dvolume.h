@@ -0,0 +1,30 @@
+#ifndef _DVOLUME_H_
+#define _DVOLUME_H_
+
+#include <sys/types.h>
+/******************************************************************************
+* SECTION: 卷
+*
+* 以多个ddriver设备组成一个逻辑设备，经ddriver_*接口访问，文件系统无需修改：
+*   raid0[:条带大小]:<设备1>,<设备2>,...    条带化，条带大小默认64k，须为512的整数倍
+*                                          条带大小为数字（可带k、m后缀）且紧跟':'，否则视为成员路径，如raid0:1.img,2.img
+*   raid1:<设备1>,<设备2>,...               镜像，写入所有成员，读取选择一个成员
+* 成员为普通磁盘文件，各自作为独立设备打开，有独立的磁盘头与虚拟时钟
+*******************************************************************************/
+#define DVOLUME_RAID0           "raid0:"
+#define DVOLUME_RAID1           "raid1:"
+
+int    dvolume_is_spec(const char *path);
+int    dvolume_owns(int fd);
+int    dvolume_open(const char *spec);
+int    dvolume_close(int fd);
+int    dvolume_seek(int fd, off_t offset, int whence);
+int    dvolume_write(int fd, char *buf, size_t size);
+int    dvolume_read(int fd, char *buf, size_t size);
+int    dvolume_ioctl(int fd, unsigned long cmd, void *arg);
+
+/* 由ddriver.c提供：卷以此把成员请求的到达时刻接在卷上一个请求完成之后 */
+long long ddriver_queue_clock(int fd);
+void   ddriver_queue_set_clock(int fd, long long clock);
+
+#endif /* _DVOLUME_H_ */
@@ -0,0 +1,67 @@
+#ifndef _BLKIO_H_
+#define _BLKIO_H_
+
+#include <stdint.h>
+#include <pthread.h>
+
+/******************************************************************************
+* SECTION: 块I/O与缓存库
+*
+* newfs、simplefs与template生成的文件系统共用的ddriver访问层：
+* 1) 对齐：任意偏移与长度的读写按块对齐后交给驱动，只有首尾不足一块的部分读-改-写，
+*    整块直接读写，不为每次调用分配缓冲区
+* 2) 缓存：定长块缓存，哈希查找、LRU替换；写直达，磁盘内容始终最新，
+*    不改变调用者的落盘顺序（newfs的日志依赖写入顺序）
+* 3) 预读：顺序读缺失时连同其后ra_blks块一并读入缓存
+* 4) 寻道：记录磁盘头位置，已在目标位置时不再seek
+* 5) 统计：驱动读写与寻道次数，缓存命中、缺失与预读块数
+*
+* 驱动读写须先seek，多线程访问时由blkio内部的互斥锁串行化
+*******************************************************************************/
+struct blkio_buf {
+    int                blkno;           // 缓存的块号，-1表示空闲
+    uint8_t*           data;
+    struct blkio_buf*  hash_next;       // 哈希链
+    struct blkio_buf*  lru_prev;        // LRU链表，表头为最近使用
+    struct blkio_buf*  lru_next;
+};
+
+struct blkio_stats {
+    uint64_t           nr_read;         // 驱动读次数（IO单位）
+    uint64_t           nr_write;        // 驱动写次数（IO单位）
+    uint64_t           nr_seek;         // 实际下发的seek次数
+    uint64_t           nr_hit;          // 缓存命中块数
+    uint64_t           nr_miss;         // 缓存缺失块数
+    uint64_t           nr_ra;           // 预读块数
+};
+
+struct blkio {
+    int                fd;              // 驱动的文件描述符
+    int                sz_io;           // 驱动读写IO单位
+    int                sz_blk;          // 块大小，须为sz_io的整数倍
+    int                nr_blks;         // 磁盘块数
+    int                pos;             // 磁盘头当前位置
+    pthread_mutex_t    lock;
+
+    struct blkio_buf*  bufs;            // 缓存块，nr_bufs为0时不缓存也不预读
+    uint8_t*           buf_data;        // 缓存块数据区，一次连续分配
+    int                nr_bufs;
+    struct blkio_buf** hash;
+    struct blkio_buf   lru;             // LRU链表头
+    int                ra_blks;         // 预读块数
+    int                ra_next;         // 上次从磁盘读到的下一块，据此判断顺序读
+
+    uint8_t*           bounce;          // 不缓存时读-改-写用的单块缓冲，读写在锁内串行，每实例一份即可
+    struct blkio_stats stats;
+};
+
+/******************************************************************************
+* SECTION: blkio.c
+*******************************************************************************/
+int    blkio_init(struct blkio * bio, int fd, int sz_blk, int nr_bufs, int ra_blks);
+int    blkio_read(struct blkio * bio, int offset, uint8_t * out_content, int size);
+int    blkio_write(struct blkio * bio, int offset, const uint8_t * in_content, int size);
+void   blkio_get_stats(struct blkio * bio, struct blkio_stats * stats);
+void   blkio_destroy(struct blkio * bio);
+
+#endif  /* _BLKIO_H_ */
@@ -0,0 +1,366 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "ddriver.h"
+#include "../include/blkio.h"
+
+#define BLKIO_MIN(a, b)         ((a) < (b) ? (a) : (b))
+#define BLKIO_HASH(bio, blkno)  (&(bio)->hash[(blkno) % (bio)->nr_bufs])
+
+/******************************************************************************
+* SECTION: 驱动访问，调用者需持有锁
+*******************************************************************************/
+// 驱动定位，已在目标位置时不再seek，使相邻块的读写不计入寻道
+static int blkio_seek(struct blkio * bio, int offset) {
+    if (bio->pos == offset) {
+        return 0;
+    }
+    if (ddriver_seek(bio->fd, offset, SEEK_SET) < 0) {
+        bio->pos = -1;
+        return -EIO;
+    }
+    bio->pos = offset;
+    bio->stats.nr_seek++;
+    return 0;
+}
+
+// 读入一块，按驱动IO单位逐次读
+static int blkio_dev_read(struct blkio * bio, int blkno, uint8_t * data) {
+    int size = bio->sz_blk;
+    if (blkio_seek(bio, blkno * bio->sz_blk) != 0) {
+        return -EIO;
+    }
+    while (size != 0) {
+        if (ddriver_read(bio->fd, (char *)data, bio->sz_io) < 0) {
+            bio->pos = -1;
+            return -EIO;
+        }
+        bio->pos += bio->sz_io;
+        bio->stats.nr_read++;
+        data     += bio->sz_io;
+        size     -= bio->sz_io;
+    }
+    return 0;
+}
+
+// 写出一块
+static int blkio_dev_write(struct blkio * bio, int blkno, const uint8_t * data) {
+    int size = bio->sz_blk;
+    if (blkio_seek(bio, blkno * bio->sz_blk) != 0) {
+        return -EIO;
+    }
+    while (size != 0) {
+        if (ddriver_write(bio->fd, (char *)data, bio->sz_io) < 0) {
+            bio->pos = -1;
+            return -EIO;
+        }
+        bio->pos += bio->sz_io;
+        bio->stats.nr_write++;
+        data     += bio->sz_io;
+        size     -= bio->sz_io;
+    }
+    return 0;
+}
+
+/******************************************************************************
+* SECTION: 块缓存，调用者需持有锁
+*******************************************************************************/
+static void blkio_lru_del(struct blkio_buf * buf) {
+    buf->lru_prev->lru_next = buf->lru_next;
+    buf->lru_next->lru_prev = buf->lru_prev;
+}
+
+// 插入到at之后，at为表头时即成为最近使用
+static void blkio_lru_add(struct blkio_buf * at, struct blkio_buf * buf) {
+    buf->lru_prev          = at;
+    buf->lru_next          = at->lru_next;
+    at->lru_next->lru_prev = buf;
+    at->lru_next           = buf;
+}
+
+// 从哈希链上摘除，缓存块变为空闲
+static void blkio_unhash(struct blkio * bio, struct blkio_buf * buf) {
+    struct blkio_buf** pp;
+    if (buf->blkno < 0) {
+        return;
+    }
+    for (pp = BLKIO_HASH(bio, buf->blkno); *pp != buf; pp = &(*pp)->hash_next);
+    *pp        = buf->hash_next;
+    buf->blkno = -1;
+}
+
+// 查找缓存块，命中时移到LRU表头
+static struct blkio_buf* blkio_lookup(struct blkio * bio, int blkno) {
+    struct blkio_buf* buf;
+    if (bio->nr_bufs == 0) {
+        return NULL;
+    }
+    for (buf = *BLKIO_HASH(bio, blkno); buf != NULL; buf = buf->hash_next) {
+        if (buf->blkno == blkno) {
+            blkio_lru_del(buf);
+            blkio_lru_add(&bio->lru, buf);
+            return buf;
+        }
+    }
+    return NULL;
+}
+
+// 取LRU表尾的缓存块改作blkno，内容由调用者填充
+static struct blkio_buf* blkio_grab(struct blkio * bio, int blkno) {
+    struct blkio_buf*  buf  = bio->lru.lru_prev;
+    struct blkio_buf** head = BLKIO_HASH(bio, blkno);
+    blkio_unhash(bio, buf);
+    buf->blkno     = blkno;
+    buf->hash_next = *head;
+    *head          = buf;
+    blkio_lru_del(buf);
+    blkio_lru_add(&bio->lru, buf);
+    return buf;
+}
+
+// 内容无效的缓存块（读写出错）作废，放回LRU表尾优先复用
+static void blkio_drop(struct blkio * bio, struct blkio_buf * buf) {
+    blkio_unhash(bio, buf);
+    blkio_lru_del(buf);
+    blkio_lru_add(bio->lru.lru_prev, buf);
+}
+
+/**
+ * @brief 读缺失时从磁盘读入blkno，顺序读时连同其后ra_blks块一并读入
+ *
+ * 预读遇到磁盘末尾或已缓存的块即停止；预读块数不超过缓存块数的一半，
+ * 不会换出本次读入的blkno
+ *
+ * @param bio
+ * @param blkno
+ * @return struct blkio_buf* IO错误时为NULL
+ */
+static struct blkio_buf* blkio_miss(struct blkio * bio, int blkno) {
+    struct blkio_buf* buf = blkio_grab(bio, blkno);
+    struct blkio_buf* ra;
+    int               is_seq = (blkno == bio->ra_next);
+    int               next;
+
+    bio->stats.nr_miss++;
+    if (blkio_dev_read(bio, blkno, buf->data) != 0) {
+        blkio_drop(bio, buf);
+        return NULL;
+    }
+    bio->ra_next = blkno + 1;
+    if (!is_seq) {
+        return buf;
+    }
+    for (next = blkno + 1; next <= blkno + bio->ra_blks && next < bio->nr_blks; next++) {
+        if (blkio_lookup(bio, next) != NULL) {
+            break;
+        }
+        ra = blkio_grab(bio, next);
+        if (blkio_dev_read(bio, next, ra->data) != 0) {
+            blkio_drop(bio, ra);                      // 预读失败不影响本次读
+            break;
+        }
+        bio->stats.nr_ra++;
+        bio->ra_next = next + 1;
+    }
+    return buf;
+}
+
+/******************************************************************************
+* SECTION: 接口
+*******************************************************************************/
+/**
+ * @brief 初始化块I/O，驱动须已打开
+ *
+ * @param bio
+ * @param fd 驱动的文件描述符
+ * @param sz_blk 块大小，须为驱动IO单位的整数倍
+ * @param nr_bufs 缓存块数，0表示不缓存
+ * @param ra_blks 顺序读时的预读块数，0表示不预读
+ * @return int 0成功，否则失败
+ */
+int blkio_init(struct blkio * bio, int fd, int sz_blk, int nr_bufs, int ra_blks) {
+    int sz_disk;
+    int i;
+
+    memset(bio, 0, sizeof(struct blkio));
+    bio->fd = fd;
+    if (ddriver_ioctl(fd, IOC_REQ_DEVICE_IO_SZ, &bio->sz_io) < 0 ||
+        ddriver_ioctl(fd, IOC_REQ_DEVICE_SIZE, &sz_disk) < 0) {
+        return -EIO;
+    }
+    if (bio->sz_io <= 0 || sz_blk <= 0 || sz_blk % bio->sz_io != 0 || nr_bufs < 0) {
+        return -EINVAL;
+    }
+    bio->sz_blk  = sz_blk;
+    bio->nr_blks = sz_disk / sz_blk;
+    bio->pos     = 0;                                 // 驱动刚打开时位于磁盘起始
+    bio->nr_bufs = nr_bufs;
+    bio->ra_blks = ra_blks < 0 ? 0 : BLKIO_MIN(ra_blks, nr_bufs / 2);
+    bio->ra_next = -1;
+    // 缓冲区按驱动IO单位对齐，整块读写可直接交给驱动
+    if (posix_memalign((void **)&bio->bounce, bio->sz_io, sz_blk) != 0) {
+        return -ENOMEM;
+    }
+
+    bio->lru.lru_prev = &bio->lru;
+    bio->lru.lru_next = &bio->lru;
+    if (nr_bufs > 0) {
+        if (posix_memalign((void **)&bio->buf_data, bio->sz_io, (size_t)nr_bufs * sz_blk) != 0) {
+            free(bio->bounce);
+            return -ENOMEM;
+        }
+        bio->bufs     = (struct blkio_buf *)calloc(nr_bufs, sizeof(struct blkio_buf));
+        bio->hash     = (struct blkio_buf **)calloc(nr_bufs, sizeof(struct blkio_buf *));
+        for (i = 0; i < nr_bufs; i++) {
+            bio->bufs[i].blkno = -1;
+            bio->bufs[i].data  = bio->buf_data + (size_t)i * sz_blk;
+            blkio_lru_add(bio->lru.lru_prev, &bio->bufs[i]);
+        }
+    }
+    pthread_mutex_init(&bio->lock, NULL);
+    return 0;
+}
+
+/**
+ * @brief 读取任意偏移与长度的数据
+ *
+ * @param bio
+ * @param offset 磁盘偏移
+ * @param out_content
+ * @param size
+ * @return int 0成功，否则失败
+ */
+int blkio_read(struct blkio * bio, int offset, uint8_t * out_content, int size) {
+    struct blkio_buf* buf;
+    int blkno = offset / bio->sz_blk;
+    int bias  = offset % bio->sz_blk;
+    int len;
+    int ret   = 0;
+
+    pthread_mutex_lock(&bio->lock);
+    while (size > 0) {
+        len = BLKIO_MIN(size, bio->sz_blk - bias);
+        if (bio->nr_bufs == 0) {
+            if (len == bio->sz_blk) {                 // 整块直接读入目标缓冲
+                ret = blkio_dev_read(bio, blkno, out_content);
+            }
+            else if ((ret = blkio_dev_read(bio, blkno, bio->bounce)) == 0) {
+                memcpy(out_content, bio->bounce + bias, len);
+            }
+        }
+        else {
+            buf = blkio_lookup(bio, blkno);
+            if (buf != NULL) {
+                bio->stats.nr_hit++;
+            }
+            else if ((buf = blkio_miss(bio, blkno)) == NULL) {
+                ret = -EIO;
+            }
+            if (buf != NULL) {
+                memcpy(out_content, buf->data + bias, len);
+            }
+        }
+        if (ret != 0) {
+            break;
+        }
+        out_content += len;
+        size        -= len;
+        blkno++;
+        bias = 0;
+    }
+    pthread_mutex_unlock(&bio->lock);
+    return ret;
+}
+
+/**
+ * @brief 写入任意偏移与长度的数据，返回时已写到驱动
+ *
+ * 整块覆盖的块不读入；部分覆盖且未缓存的块先读入再修改
+ *
+ * @param bio
+ * @param offset 磁盘偏移
+ * @param in_content
+ * @param size
+ * @return int 0成功，否则失败
+ */
+int blkio_write(struct blkio * bio, int offset, const uint8_t * in_content, int size) {
+    struct blkio_buf* buf;
+    uint8_t* data;
+    int blkno = offset / bio->sz_blk;
+    int bias  = offset % bio->sz_blk;
+    int len;
+    int ret   = 0;
+
+    pthread_mutex_lock(&bio->lock);
+    while (size > 0) {
+        len = BLKIO_MIN(size, bio->sz_blk - bias);
+        buf = blkio_lookup(bio, blkno);
+        if (buf != NULL) {
+            bio->stats.nr_hit++;
+            data = buf->data;
+        }
+        else if (bio->nr_bufs > 0) {
+            buf  = blkio_grab(bio, blkno);
+            data = buf->data;
+            if (len != bio->sz_blk) {
+                bio->stats.nr_miss++;
+                ret = blkio_dev_read(bio, blkno, data);
+            }
+        }
+        else if (len == bio->sz_blk) {
+            data = NULL;                              // 不缓存时整块直接写出
+        }
+        else {
+            data = bio->bounce;
+            bio->stats.nr_miss++;
+            ret  = blkio_dev_read(bio, blkno, data);
+        }
+
+        if (ret == 0 && data == NULL) {
+            ret = blkio_dev_write(bio, blkno, in_content);
+        }
+        else if (ret == 0) {
+            memcpy(data + bias, in_content, len);
+            ret = blkio_dev_write(bio, blkno, data);
+        }
+        if (ret != 0) {
+            if (buf != NULL) {
+                blkio_drop(bio, buf);
+            }
+            break;
+        }
+        in_content += len;
+        size       -= len;
+        blkno++;
+        bias = 0;
+    }
+    pthread_mutex_unlock(&bio->lock);
+    return ret;
+}
+
+/**
+ * @brief 读取统计信息
+ *
+ * @param bio
+ * @param stats
+ */
+void blkio_get_stats(struct blkio * bio, struct blkio_stats * stats) {
+    pthread_mutex_lock(&bio->lock);
+    memcpy(stats, &bio->stats, sizeof(struct blkio_stats));
+    pthread_mutex_unlock(&bio->lock);
+}
+
+/**
+ * @brief 释放缓存，驱动由调用者关闭
+ *
+ * @param bio
+ */
+void blkio_destroy(struct blkio * bio) {
+    free(bio->bufs);
+    free(bio->buf_data);
+    free(bio->hash);
+    free(bio->bounce);
+    pthread_mutex_destroy(&bio->lock);
+    memset(bio, 0, sizeof(struct blkio));
+}
@@ -7,7 +7,12 @@
 /**
  * @brief 打开ddriver设备
  * 
- * @param path ddriver设备路径
+ * 每次打开得到设备的一个新队列，磁盘头与读写计数各自独立；
+ * 再次打开同一路径时与已有队列共享设备的数据、映射与虚拟时钟。
+ * path也可以是卷描述，如raid0:64k:/a,/b（条带化）或raid1:/a,/b（镜像），
+ * 卷由多个设备组成，以同样的接口访问
+ * 
+ * @param path ddriver设备路径，即任意磁盘文件，不存在时创建；或卷描述
  * @return int 0成功，否则失败
  */
 int ddriver_open(char *path);
@@ -60,4 +65,18 @@ int ddriver_ioctl(int fd, unsigned long cmd, void *ret);
  */
 int ddriver_close(int fd);
 
+/**
+ * @brief 返回磁盘区间的直接指针（零拷贝），仅mmap模式可用
+ * 
+ * 环境变量DDRIVER_MMAP非空且不为0时，ddriver_open映射整个磁盘文件，
+ * 读写变为内存拷贝，IOC_REQ_DEVICE_FLUSH以msync写回。
+ * 经指针的访问不计入读写次数，也不模拟延迟
+ * 
+ * @param fd ddriver设备handler
+ * @param offset 区间起点，注意要和设备IO单位对齐
+ * @param size 区间大小
+ * @return char* 非mmap模式或区间越界时为NULL
+ */
+char *ddriver_map(int fd, off_t offset, size_t size);
+
 #endif /* _DDRIVER_H_ */
\ No newline at end of file
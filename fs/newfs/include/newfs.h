@@ -9,7 +9,11 @@
 #include "string.h"
 #include "fuse.h"
 #include <stddef.h>
+#include <time.h>
+#include <pthread.h>
+#include <linux/falloc.h>
 #include "ddriver.h"
+#include "blkio.h"
 #include "errno.h"
 #include "types.h"
 
@@ -25,21 +29,98 @@
 * SECTION: newfs_utils.c
 *******************************************************************************/
 char* 			   nfs_get_fname(const char* path);		// 获取文件名
-int 			   fs_calc_lvl(const char * path);		// 计算路径的层级
+uint32_t 		   nfs_hash_name(const char* name, int len);	// 计算文件名哈希
+int 			   nfs_calc_lvl(const char * path);		// 计算路径的层级
 int 			   nfs_driver_read(int offset, uint8_t *out_content, int size);		// 驱动读
 int 			   nfs_driver_write(int offset, uint8_t *in_content, int size);		// 驱动写
+void 			   nfs_pack_inode(struct nfs_inode * inode, struct nfs_inode_d * inode_d);	// 填充磁盘inode_d
 int 			   nfs_alloc_dentry(struct nfs_inode * inode, struct nfs_dentry * dentry);	// 为一个inode分配dentry，采用头插法
 int 			   nfs_drop_dentry(struct nfs_inode * inode, struct nfs_dentry * dentry);	// 将dentry从inode的dentrys中取出
+void 			   nfs_touch_inode(struct nfs_inode * inode, boolean mtime);	// 更新ctime（与mtime）
+void 			   nfs_update_atime(struct nfs_inode * inode);	// 按atime策略更新访问时间
+int 			   nfs_detach_dentry(struct nfs_dentry * dentry);	// 从父目录摘除dentry，去掉该名字
+void 			   nfs_put_dentry(struct nfs_dentry * dentry);	// 链接数减1，最后一个名字时inode交由后台回收
 struct nfs_inode*  nfs_alloc_inode(struct nfs_dentry * dentry);		// 分配一个inode，占用位图
 int 			   nfs_sync_inode(struct nfs_inode * inode);		// 将内存inode及其下方结构全部刷回磁盘
-int 			   nfs_drop_inode(struct nfs_inode * inode);		// 删除内存中的一个inode， 暂时不释放
+int 			   nfs_alloc_data(struct nfs_inode * inode);		// 为延迟分配的数据块分配磁盘块
+int 			   nfs_prealloc_data(struct nfs_inode * inode, int first, int last);	// 预分配数据块
+int 			   nfs_sync_data(struct nfs_inode * inode);		// 写回文件的脏数据块
+int 			   nfs_truncate_data(struct nfs_inode * inode, int size, int* blknos);	// 截断文件，释放尾部数据块
+int 			   nfs_drop_inode(struct nfs_inode * inode, struct nfs_free_batch * batch);	// 删除内存中的inode子树，收集待释放的ino与数据块
 struct nfs_inode*  nfs_read_inode(struct nfs_dentry * dentry, int ino);	// dentry指向ino，读取该inode
 struct nfs_dentry* nfs_get_dentry(struct nfs_inode * inode, int dir);	// 获得指向该inode的dentry
 
 struct nfs_dentry* nfs_lookup(const char * path, boolean * is_find, boolean* is_root);	// 查找路径对应文件，存在返回其dentry，不存在返回父目录
+boolean 		   nfs_is_parent(struct nfs_dentry* dir, const char* path);	// dir是否为path的上一级目录
+void 			   nfs_pack_super(struct nfs_super_d * super_d);	// 填充磁盘超级块super_d
+int 			   nfs_sync_super();							// 写回超级块与位图
 int 			   nfs_mount(struct custom_options options);	// 挂载nfs
 int 			   nfs_umount();								// 卸载nfs
 /******************************************************************************
+* SECTION: newfs_slab.c
+*******************************************************************************/
+void 			   nfs_slab_init(struct nfs_slab* slab, int obj_sz);	// 初始化slab缓存
+void* 			   nfs_slab_alloc(struct nfs_slab* slab);		// 从slab分配一个清零对象
+void 			   nfs_slab_free(struct nfs_slab* slab, void* obj);	// 将对象归还slab
+void 			   nfs_slab_destroy(struct nfs_slab* slab);		// 释放slab的全部内存
+int 			   nfs_names_init(struct nfs_name_arena* arena);	// 初始化文件名arena
+const char* 	   nfs_name_intern(struct nfs_name_arena* arena, const char* name, int len, uint32_t hash);	// 驻留长文件名并增加引用
+void 			   nfs_name_put(struct nfs_name_arena* arena, const char* str);	// 释放长文件名的引用
+void 			   nfs_names_destroy(struct nfs_name_arena* arena);	// 释放文件名arena
+int 			   nfs_dentry_set_name(struct nfs_dentry* dentry, const char * fname);	// 设置dentry的文件名
+struct nfs_dentry* new_dentry(const char * fname, NFS_FILE_TYPE ftype);	// 新建内存dentry
+void 			   free_dentry(struct nfs_dentry* dentry);		// 释放内存dentry
+/******************************************************************************
+* SECTION: newfs_dir.c
+*******************************************************************************/
+void 			   nfs_dir_init_blk(uint8_t* blk);		// 初始化空目录块
+boolean 		   nfs_dir_has_room(struct nfs_inode* dir, const char* fname);	// 目录能否容纳新目录项
+int 			   nfs_dir_add_rec(struct nfs_inode* dir, struct nfs_dentry* dentry);	// 向目录块写入目录项记录
+int 			   nfs_dir_del_rec(struct nfs_inode* dir, struct nfs_dentry* dentry);	// 从目录块原地删除目录项记录
+int 			   nfs_dir_set_rec(struct nfs_inode* dir, struct nfs_dentry* dentry, struct nfs_dentry* target);	// 目录项记录原地改指target的inode
+int 			   nfs_dir_load(struct nfs_inode* dir);	// 解析目录块，建立内存dentry
+/******************************************************************************
+* SECTION: newfs_alloc.c
+*******************************************************************************/
+int 			   nfs_groups_init(const struct nfs_group_d* groups_d);	// 载入或由位图重建空闲统计
+void 			   nfs_groups_pack(struct nfs_group_d* groups_d);	// 填充超级块中的块组统计
+void 			   nfs_groups_destroy();				// 释放块组统计信息
+int 			   nfs_new_inode(int parent_ino, boolean is_dir);	// 按块组策略分配ino
+void 			   nfs_free_inode(int ino, boolean is_dir);	// 释放ino
+void 			   nfs_free_inodes(int* inos, int cnt, boolean is_dir);	// 按ino排序后批量释放
+int 			   nfs_new_block(int goal);				// 从goal附近分配数据块
+int 			   nfs_new_blocks(int goal, int cnt, int* blknos);	// 一次分配cnt个尽量连续的数据块
+int 			   nfs_resv_blocks(int cnt);			// 为延迟分配预留数据块
+void 			   nfs_unresv_blocks(int cnt);			// 归还预留的数据块
+void 			   nfs_free_block(int blkno);			// 释放数据块
+void 			   nfs_free_blocks(int* blknos, int cnt);	// 按块号排序后批量释放数据块
+/******************************************************************************
+* SECTION: newfs_journal.c
+*******************************************************************************/
+int 			   nfs_jnl_replay(int journal_offset, int journal_blks, uint32_t* next_seq);	// 重放日志
+int 			   nfs_jnl_init(uint32_t seq, boolean is_init);	// 初始化日志，启动后台提交线程
+void 			   nfs_jnl_begin();						// 开始元数据操作
+int 			   nfs_jnl_end();						// 结束元数据操作
+void 			   nfs_jnl_dirty_blk(int blkno, const uint8_t* buf);	// 记录被修改的元数据块
+void 			   nfs_jnl_dirty_inode(struct nfs_inode* inode);	// 记录inode块及脏目录块
+void 			   nfs_jnl_dirty_map_inode(int ino);	// 记录inode位图块
+void 			   nfs_jnl_dirty_map_data(int blkno);	// 记录数据位图块
+void 			   nfs_jnl_dirty_super();				// 记录超级块（空闲统计）
+uint32_t 		   nfs_jnl_running_seq();				// 运行事务序号
+int 			   nfs_jnl_commit();					// 立即提交运行事务
+int 			   nfs_jnl_wait(uint32_t seq);			// 等待事务提交，并发调用合并为一次提交
+int 			   nfs_jnl_wait_commit(uint32_t seq);	// 等待事务随定时提交落盘
+int 			   nfs_jnl_checkpoint();				// 提交并检查点，清空日志区
+int 			   nfs_jnl_destroy();					// 提交并检查点，停止日志
+/******************************************************************************
+* SECTION: newfs_reclaim.c
+*******************************************************************************/
+void 			   nfs_batch_add_ino(struct nfs_free_batch* batch, int ino, boolean is_dir);	// 记录待释放的ino
+void 			   nfs_batch_add_blk(struct nfs_free_batch* batch, int blkno);	// 记录待释放的数据块
+int 			   nfs_reclaim_init(int orphan_head);	// 读入孤儿链表，启动回收线程
+void 			   nfs_reclaim_add(struct nfs_inode* inode);	// 加入孤儿链表，交由后台回收
+void 			   nfs_reclaim_destroy();				// 回收剩余孤儿，停止回收线程
+/******************************************************************************
 * SECTION: newfs.c
 *******************************************************************************/
 void* 			   nfs_init(struct fuse_conn_info *);	// 挂载nfs
@@ -57,10 +138,21 @@ int   			   nfs_access(const char *, int);	// 访问文件
 int   			   nfs_unlink(const char *);	// 删除文件
 int   			   nfs_rmdir(const char *);		// 删除目录
 int   			   nfs_rename(const char *, const char *);	// 重命名文件
-int   			   nfs_utimens(const char *, const struct timespec tv[2]);	// 修改时间，为了不让touch报错
+int   			   nfs_link(const char *, const char *);	// 创建硬链接
+int   			   nfs_symlink(const char *, const char *);	// 创建符号链接
+int   			   nfs_readlink(const char *, char *, size_t);	// 读取符号链接目标
+int   			   nfs_chmod(const char *, mode_t);		// 修改权限
+int   			   nfs_chown(const char *, uid_t, gid_t);	// 修改属主与属组
+int   			   nfs_utimens(const char *, const struct timespec tv[2]);	// 修改访问与修改时间
 int   			   nfs_truncate(const char *, off_t);	// 改变文件大小
 			
 int   			   nfs_open(const char *, struct fuse_file_info *);		// 打开文件
 int   			   nfs_opendir(const char *, struct fuse_file_info *);	//打开目录
+int   			   nfs_flush(const char *, struct fuse_file_info *);	// 关闭文件时写回
+int   			   nfs_fsync(const char *, int, struct fuse_file_info *);	// 同步文件
+int   			   nfs_fsyncdir(const char *, int, struct fuse_file_info *);	// 同步目录
+int   			   nfs_statfs(const char *, struct statvfs *);	// 文件系统空闲统计
+int   			   nfs_ioctl(const char *, int, void *, struct fuse_file_info *, unsigned int, void *);	// SEEK_DATA/SEEK_HOLE
+int   			   nfs_fallocate(const char *, int, off_t, off_t, struct fuse_file_info *);	// 预分配文件空间
 
 #endif  /* _nfs_H_ */
\ No newline at end of file
@@ -9,8 +9,15 @@ typedef uint16_t     flag16;
 
 typedef enum nfs_file_type {
     NFS_REG_FILE,   // 文件
-    NFS_DIR         // 目录
+    NFS_DIR,        // 目录
+    NFS_SYM_LINK    // 符号链接
 } NFS_FILE_TYPE;
+
+typedef enum nfs_atime_mode {
+    NFS_ATIME_RELATIME,     // 默认：atime不晚于mtime/ctime或超过一天时才更新
+    NFS_ATIME_STRICT,       // 每次读取都更新
+    NFS_ATIME_NOATIME       // 从不因读取更新
+} NFS_ATIME_MODE;
 /******************************************************************************
 * SECTION: Macro
 *******************************************************************************/
@@ -19,16 +26,18 @@ typedef enum nfs_file_type {
 #define UINT32_BITS             32
 #define UINT8_BITS              8
 
-#define NFS_MAGIC_NUM           200110132   // 自定义幻数
+#define NFS_MAGIC_NUM           200110133   // 自定义幻数，磁盘格式改变时递增，旧格式的磁盘按新格式重新格式化
 #define NFS_SUPER_OFS           0           // 超级块磁盘偏移，0
 #define NFS_ROOT_INO            0           // 根目录inode编号，0
 
 // 自行规定位图的大小
 #define NFS_SUPER_BLK           1           // 超级块数
-#define NFS_MAP_INODE_BLK       1           // inode位图所占块数
-#define NFS_MAP_DATA_BLK        1           // data位图所占块数
-#define NFS_INODE_BLK           512         // inode最大块数
-#define NFS_DATA_BLK            2048        // data最大块数
+#define NFS_JOURNAL_BLK         256         // 元数据日志区块数
+#define NFS_GROUP_CNT           4           // 块组数
+#define NFS_INODES_PER_GROUP    128         // 每个块组的inode数（每个inode占一块）
+#define NFS_DATA_PER_GROUP      512         // 每个块组的数据块数
+#define NFS_MAP_INODE_BLK       NFS_GROUP_CNT   // inode位图所占块数，每个块组一块
+#define NFS_MAP_DATA_BLK        NFS_GROUP_CNT   // data位图所占块数，每个块组一块
 
 #define NFS_ERROR_NONE          0
 #define NFS_ERROR_ACCESS        EACCES
@@ -40,17 +49,56 @@ typedef enum nfs_file_type {
 #define NFS_ERROR_UNSUPPORTED   ENXIO
 #define NFS_ERROR_IO            EIO     /* Error Input/Output */
 #define NFS_ERROR_INVAL         EINVAL  /* Invalid Args */
+#define NFS_ERROR_NAMETOOLONG   ENAMETOOLONG
+#define NFS_ERROR_FBIG          EFBIG
+#define NFS_ERROR_NXIO          ENXIO   /* SEEK_DATA/SEEK_HOLE越过文件尾 */
+#define NFS_ERROR_NOTDIR        ENOTDIR
+#define NFS_ERROR_NOTEMPTY      ENOTEMPTY
+#define NFS_ERROR_BUSY          EBUSY
+#define NFS_ERROR_PERM          EPERM
+#define NFS_ERROR_NOMEM         ENOMEM
 
 #define NFS_MAX_FILE_NAME       128
+#define NFS_INLINE_NAME_LEN     13      // dentry内联存放的短文件名长度（含'\0'）
 //#define NFS_INODE_PER_FILE      1
 #define NFS_DATA_PER_FILE       4       // 文件最大为4*1024KB
 #define NFS_DEFAULT_PERM        0777    // 全权限打开
+#define NFS_DIR_PERM            0755    // 根目录的默认权限
+#define NFS_FAST_LINK_LEN       64      // 短于此长度的符号链接目标内联存于inode（含'\0'）
+#define NFS_RELATIME_SEC        (24 * 60 * 60)  // relatime下atime至少每隔一天更新一次
 
 #define NFS_IOC_MAGIC           'S'
-#define NFS_IOC_SEEK            _IO(NFS_IOC_MAGIC, 0)
+#define NFS_IOC_SEEK            _IOWR(NFS_IOC_MAGIC, 0, struct nfs_ioc_seek)    // FUSE无lseek回调，经ioctl实现SEEK_DATA/SEEK_HOLE
+#ifndef SEEK_DATA
+#define SEEK_DATA               3
+#define SEEK_HOLE               4
+#endif
 
 #define NFS_FLAG_BUF_DIRTY      0x1
 #define NFS_FLAG_BUF_OCCUPY     0x2
+#define NFS_FLAG_BUF_DELAY      0x4     // 数据已写入缓冲区但尚未分配磁盘块，已预留空闲块
+#define NFS_FLAG_BUF_UNWRITTEN  0x8     // 已预分配磁盘块但尚未写入，读取时为零
+#define NFS_BLKNO_NONE          -1      // 未分配磁盘块的数据块号
+
+#define NFS_DIR_REC_HDR_SZ      8       // 目录记录头部大小（ino, rec_len, name_len, ftype）
+#define NFS_DIR_REC_ALIGN       4       // 目录记录按4字节对齐
+
+#define NFS_CACHELINE_SZ        64      // 缓存行大小，slab对象按此对齐
+#define NFS_SLAB_CHUNK_SZ       (64 * 1024) // slab每次向系统申请的大小
+#define NFS_NAME_CHUNK_SZ       (64 * 1024) // 文件名arena每次向系统申请的大小
+#define NFS_NAME_TABLE_INIT     1024        // 文件名驻留哈希表初始槽数
+#define NFS_NAME_ALIGN          8           // 驻留文件名按8字节对齐，按对齐后的大小分级复用
+#define NFS_NAME_CLASSES        ((8 + NFS_MAX_FILE_NAME) / NFS_NAME_ALIGN + 1)  // 驻留文件名大小级数
+#define NFS_BIO_CACHE_BLKS      256         // 块I/O缓存块数
+#define NFS_BIO_RA_BLKS         8           // 顺序读时的预读块数
+
+#define NFS_JNL_HDR_MAGIC       0x4A4E4C48  // 日志头幻数 "JNLH"
+#define NFS_JNL_DESC_MAGIC      0x4A4E4C44  // 描述块幻数 "JNLD"
+#define NFS_JNL_COMMIT_MAGIC    0x4A4E4C43  // 提交块幻数 "JNLC"
+#define NFS_JNL_TXN_MAX         64          // 单个事务最多记录的块数，需能放入一个描述块
+#define NFS_JNL_OP_MAX_BLKS     16          // 单个操作最多修改的元数据块数
+#define NFS_JNL_BATCH_BLKS      32          // 运行事务累积到该块数即提交
+#define NFS_JNL_COMMIT_INTERVAL 1           // 后台提交间隔（秒）
 /******************************************************************************
 * SECTION: Macro Function
 *******************************************************************************/
@@ -59,32 +107,138 @@ typedef enum nfs_file_type {
 #define NFS_DISK_SZ()                   (nfs_super.sz_disk)     // 磁盘大小
 #define NFS_DRIVER()                    (nfs_super.driver_fd)   // 驱动的文件描述符
 
-#define NFS_ROUND_DOWN(value, round)    (value % round == 0 ? value : (value / round) * round)
-#define NFS_ROUND_UP(value, round)      (value % round == 0 ? value : (value / round + 1) * round)
+#define NFS_ROUND_DOWN(value, round)    ((value) % (round) == 0 ? (value) : ((value) / (round)) * (round))
+#define NFS_ROUND_UP(value, round)      ((value) % (round) == 0 ? (value) : ((value) / (round) + 1) * (round))
 
 // #define NFS_BLKS_SZ(blks)               (blks * NFS_IO_SZ())
-#define NFS_BLKS_SZ(blks)               (blks * NFS_BLK_SZ())   // 若干块的空间大小
-#define NFS_ASSIGN_FNAME(pnfs_dentry, _fname)   memcpy(pnfs_dentry->fname, _fname, strlen(_fname))
+#define NFS_BLKS_SZ(blks)               ((blks) * NFS_BLK_SZ()) // 若干块的空间大小
 // #define NFS_INO_OFS(ino)                (nfs_super.data_offset + ino * NFS_BLKS_SZ((
 //                                         NFS_INODE_PER_FILE + NFS_DATA_PER_FILE)))
-#define NFS_INO_OFS(ino)                (nfs_super.inode_offset + NFS_BLKS_SZ(ino)) // 第ino个inode块磁盘偏移
-#define NFS_DATA_OFS(ino)               (nfs_super.data_offset + NFS_BLKS_SZ(ino))  // 第ino个数据块磁盘偏移
+#define NFS_INO_GROUP(ino)              ((ino) / nfs_super.inodes_per_group)        // ino所在块组
+#define NFS_BLK_GROUP(blkno)            ((blkno) / nfs_super.data_per_group)        // 数据块所在块组
+#define NFS_GROUP_OFS(g)                (nfs_super.group_offset + NFS_BLKS_SZ((g) * \
+                                         (nfs_super.inodes_per_group + nfs_super.data_per_group)))  // 第g个块组磁盘偏移
+#define NFS_INO_OFS(ino)                (NFS_GROUP_OFS(NFS_INO_GROUP(ino)) + \
+                                         NFS_BLKS_SZ((ino) % nfs_super.inodes_per_group))   // 第ino个inode块磁盘偏移
+#define NFS_DATA_OFS(blkno)             (NFS_GROUP_OFS(NFS_BLK_GROUP(blkno)) + NFS_BLKS_SZ( \
+                                         nfs_super.inodes_per_group + (blkno) % nfs_super.data_per_group)) // 第blkno个数据块磁盘偏移
+#define NFS_JNL_OFS(blk)                (nfs_super.journal_offset + NFS_BLKS_SZ(blk)) // 日志区第blk块磁盘偏移
+#define NFS_BLKNO(offset)               ((offset) / NFS_BLK_SZ())                   // 磁盘偏移所在块号
 
-#define NFS_IS_DIR(pinode)              (pinode->dentry->ftype == NFS_DIR)
-#define NFS_IS_REG(pinode)              (pinode->dentry->ftype == NFS_REG_FILE)
+#define NFS_DIR_REC_LEN(name_len)       ((NFS_DIR_REC_HDR_SZ + (name_len) + NFS_DIR_REC_ALIGN - 1) \
+                                         / NFS_DIR_REC_ALIGN * NFS_DIR_REC_ALIGN)    // 目录记录实际占用长度
+
+#define NFS_IS_DIR(pinode)              ((pinode)->ftype == NFS_DIR)
+#define NFS_IS_REG(pinode)              ((pinode)->ftype == NFS_REG_FILE)
+#define NFS_IS_SYM_LINK(pinode)         ((pinode)->ftype == NFS_SYM_LINK)
+#define NFS_IS_FAST_LINK(pinode)        (NFS_IS_SYM_LINK(pinode) && (pinode)->size < NFS_FAST_LINK_LEN)
+#define NFS_TIME_CMP(a, b)              ((a).tv_sec != (b).tv_sec ? ((a).tv_sec > (b).tv_sec ? 1 : -1) : \
+                                         ((a).tv_nsec > (b).tv_nsec) - ((a).tv_nsec < (b).tv_nsec))  // 比较两个timespec
+// 数据块i是否含有数据：已写入磁盘块，或延迟分配中；空洞与预分配未写入的块读取为零
+#define NFS_BLK_HAS_DATA(pinode, i)     (((pinode)->block_flag[i] & NFS_FLAG_BUF_DELAY) || \
+                                         ((pinode)->blockno[i] != NFS_BLKNO_NONE &&       \
+                                          !((pinode)->block_flag[i] & NFS_FLAG_BUF_UNWRITTEN)))
 /******************************************************************************
 * SECTION: FS Specific Structure - In memory structure
 *******************************************************************************/
 struct nfs_dentry;
 struct nfs_inode;
 struct nfs_super;
+struct nfs_slab;
+struct nfs_name_arena;
+struct nfs_jnl_txn;
+struct nfs_journal;
+struct nfs_reclaim;
+struct nfs_free_batch;
+struct nfs_group;
 
 struct custom_options {
 	const char*        device;                      // 驱动的路径
+	int                atime;                       // atime更新策略（NFS_ATIME_MODE）
+};
+
+struct nfs_ioc_seek {
+    int64_t            offset;          // 传入查找起点，返回找到的偏移
+    int                whence;          // SEEK_DATA或SEEK_HOLE
+};
+
+struct nfs_slab {
+    int                obj_sz;          // 对象大小（按缓存行向上取整）
+    int                objs_per_chunk;  // 每个chunk容纳的对象数
+    void*              free_list;       // 空闲对象链表，链接指针存于对象头部
+    void*              chunks;          // 已申请chunk链表，卸载时整体释放
+    int                nr_inuse;        // 正在使用的对象数
+};
+
+struct nfs_name {
+    uint32_t           refcnt;          // 引用该文件名的dentry数，为0时回收
+    uint32_t           hash;            // 文件名哈希，哈希表扩容与删除时使用
+    char               str[];           // 以'\0'结尾的文件名
+};
+
+struct nfs_name_arena {
+    uint8_t*           chunk;           // 当前写入的chunk
+    int                used;            // 当前chunk已用字节数
+    void*              chunks;          // 已申请chunk链表，卸载时整体释放
+    void*              free_names[NFS_NAME_CLASSES];    // 按大小分级的已回收文件名链表
+    const char**       table;           // 驻留哈希表，相同的长文件名只存一份
+    int                table_sz;        // 哈希表槽数（2的幂）
+    int                nr_names;        // 已驻留文件名数
+};
+
+struct nfs_group {
+    int                free_inodes;     // 空闲inode数
+    int                free_blks;       // 空闲数据块数
+    int                nr_dirs;         // 目录数，用于分散新目录
+};
+
+struct nfs_jnl_txn {
+    uint32_t           seq;                         // 事务序号
+    int                nr_blks;                     // 事务中记录的块数
+    int                blknos[NFS_JNL_TXN_MAX];     // 各块在磁盘上的块号
+    uint8_t*           imgs[NFS_JNL_TXN_MAX];       // 各块在操作结束时的镜像
+};
+
+struct nfs_journal {
+    pthread_mutex_t    lock;            // 保护运行事务，元数据操作期间持有
+    pthread_cond_t     cond;            // 唤醒后台提交线程
+    pthread_cond_t     commit_cond;     // 一次提交完成时广播，唤醒等待提交的fsync
+    pthread_t          committer;       // 后台提交线程
+    boolean            stopping;        // 卸载时通知提交线程退出
+    boolean            committing;      // 是否有事务正在写日志
+    struct nfs_jnl_txn running;         // 运行中的复合事务，由多个操作共享
+    struct nfs_jnl_txn commit;          // 正在写日志的事务，写日志期间不持有lock
+    uint32_t           commit_seq;      // 最近一次提交的事务序号
+    int                aborted;         // 提交失败后记录错误码，此后不再提交，等待未提交事务者返回该错误
+    int                head;            // 日志区下一个可写块（相对日志区起点）
+    int                nr_ckpt;         // 已提交但未写回原位置的块数
+    int                ckpt_blknos[NFS_JOURNAL_BLK];    // 待检查点块的块号
+    uint8_t*           ckpt_imgs[NFS_JOURNAL_BLK];      // 待检查点块的最新已提交镜像
+    uint8_t*           desc_buf;        // 描述块缓冲区，同一时刻只有一个提交者，挂载期间复用
+};
+
+struct nfs_reclaim {
+    pthread_t          reclaimer;       // 后台回收线程
+    pthread_cond_t     cond;            // 有孤儿inode或卸载时唤醒，配合journal.lock使用
+    boolean            stopping;        // 卸载时通知回收线程处理完剩余孤儿后退出
+    struct nfs_inode*  orphans;         // 孤儿链表：已从目录中摘除、尚未释放的inode，与磁盘上的链表一致
+};
+
+struct nfs_free_batch {
+    int*               inos;            // 待释放的文件ino
+    int                nr_inos;
+    int*               dir_inos;        // 待释放的目录ino
+    int                nr_dir_inos;
+    int*               blknos;          // 待释放的数据块号
+    int                nr_blks;
+    int                cap_inos;        // 三个数组的容量
+    int                cap_dir_inos;
+    int                cap_blks;
 };
 
 struct nfs_super {
     int                driver_fd;       // 驱动的文件描述符
+    struct blkio       bio;             // 块I/O：对齐、缓存、预读与寻道合并，多线程访问时内部串行化
     int                sz_io;           // 读写IO单位大小 (512B)
     // 驱动读写IO单位为sz_io(512B)，ext2块大小为1024B
     // 需将涉及块大小（除驱动读写IO外）的NFS_IO_SZ()（即sz_io）修改为NFS_BLK_SZ()（即sz_blk）
@@ -93,6 +247,10 @@ struct nfs_super {
 
     int                max_ino;         // inode最大数目
     int                max_data;        // data最大数目
+    struct nfs_group*  groups;          // 各块组的空闲统计，由分配器增量维护
+    int                free_inodes;     // 全局空闲inode数，statfs直接返回
+    int                free_blks;       // 全局空闲数据块数
+    int                resv_blks;       // 延迟分配预留的数据块数，写回时才真正分配
     
     uint8_t*           map_inode;       // inode位图起始地址
     uint8_t*           map_data;        // data位图起始地址
@@ -101,8 +259,17 @@ struct nfs_super {
 
     struct nfs_dentry* root_dentry;     // 根目录
 
+    struct nfs_slab    dentry_slab;     // 内存dentry缓存
+    struct nfs_slab    inode_slab;      // 内存inode缓存
+    struct nfs_slab    blk_slab;        // 数据块缓冲区缓存
+    struct nfs_name_arena name_arena;   // 长文件名arena
+    struct nfs_journal journal;         // 元数据日志
+    struct nfs_reclaim reclaim;         // 孤儿inode后台回收
+    struct nfs_inode** icache;          // 按ino索引的已读入inode，同一文件的多个名字共享一个inode
+
     // 需与磁盘同步内容
-    int                sz_usage;        // 已用空间大小
+    int                journal_blks;    // 日志区占用的块数
+    int                journal_offset;  // 日志区在磁盘上的偏移
 
     int                map_inode_blks;  // inode位图占用的块数
     int                map_inode_offset;// inode位图在磁盘上的偏移
@@ -110,52 +277,67 @@ struct nfs_super {
     int                map_data_blks;   // data位图占用的块数
     int                map_data_offset; // data位图在磁盘上的偏移
     
-    int                inode_offset;    // inode起始位置在磁盘上的偏移
-    int                data_offset;     // data起始位置在磁盘上的偏移
+    int                nr_groups;       // 块组数
+    int                inodes_per_group;// 每个块组的inode数
+    int                data_per_group;  // 每个块组的数据块数
+    int                group_offset;    // 块组0在磁盘上的偏移
 
 };
 
 struct nfs_inode {
-    struct nfs_dentry* dentry;                      // 指向该inode的目录项（父节点目录中某一目录项）
-    struct nfs_dentry* dentrys;                     // 若为目录，该目录中所有目录项的链表起始地址
-    uint8_t*           block_pointer[NFS_DATA_PER_FILE];    // 指向的数据块指针（固定分配6个）
-    // 需与磁盘同步内容
+    // 查找与同步时常用的字段集中在前
     int                ino;                         // ino编号
     int                size;                        // 文件已占用空间
     int                dir_cnt;                     // 若为目录，目录项dentry数目
+    NFS_FILE_TYPE      ftype;                       // 文件类型，不依赖dentry，硬链接共享同一inode
+    int                nlink;                       // 链接数：文件为名字数，目录为2加子目录数
+    struct nfs_dentry* dentry;                      // 目录为其唯一的目录项；文件为某一个名字，可为NULL
+    boolean            dirty;                       // 属性已修改但尚未记入日志
+    mode_t             mode;                        // 权限位
+    uid_t              uid;                         // 属主
+    gid_t              gid;                         // 属组
+    struct timespec    atime;                       // 访问时间
+    struct timespec    mtime;                       // 内容修改时间
+    struct timespec    ctime;                       // 属性修改时间
+    struct nfs_dentry* dentrys;                     // 若为目录，该目录中所有目录项的链表起始地址
+    // 需与磁盘同步内容
     int                blockno[NFS_DATA_PER_FILE];  // 指向的数据块在磁盘中的块号
+    uint8_t*           block_pointer[NFS_DATA_PER_FILE];    // 指向的数据块缓冲区（从blk_slab分配）
+    flag16             block_flag[NFS_DATA_PER_FILE];       // 数据块缓冲区状态，NFS_FLAG_BUF_DIRTY表示需写回
+    uint32_t           jnl_seq;                     // 最近一次记录该inode的日志事务序号，fsync等待其提交
+    struct nfs_inode*  orphan_next;                 // 孤儿链表中的下一个inode
 };
 
 struct nfs_dentry {
-    struct nfs_dentry* parent;                      // 父亲inode的dentry
-    struct nfs_dentry* brother;                     // 兄弟inode的dentry
-    struct nfs_inode*  inode;                       // 指向的inode
-    // 需与磁盘同步内容
-    char               fname[NFS_MAX_FILE_NAME];    // 文件名
+    // 查找热路径字段，整个dentry不超过一个缓存行
+    uint32_t           fhash;                       // 文件名哈希，比较文件名前先比较哈希与长度
     int                ino;                         // 指向的ino编号
-    NFS_FILE_TYPE      ftype;                       // 文件类型（文件/目录）
-};
-
-static inline struct nfs_dentry* new_dentry(char * fname, NFS_FILE_TYPE ftype) {
-    struct nfs_dentry * dentry = (struct nfs_dentry *)malloc(sizeof(struct nfs_dentry));
-    memset(dentry, 0, sizeof(struct nfs_dentry));
-    NFS_ASSIGN_FNAME(dentry, fname);
-    dentry->ftype   = ftype;
-    dentry->ino     = -1; 
-    dentry->inode   = NULL;
-    dentry->parent  = NULL;
-    dentry->brother = NULL;
-    return dentry;
-}
+    struct nfs_inode*  inode;                       // 指向的inode
+    struct nfs_dentry* brother;                     // 兄弟inode的dentry
+    uint16_t           fname_len;                   // 文件名长度
+    uint8_t            ftype;                       // 文件类型（NFS_FILE_TYPE）
+    char               fname_inline[NFS_INLINE_NAME_LEN];   // 短文件名直接存于dentry内
+    struct nfs_dentry* parent;                      // 父亲inode的dentry
+    const char*        fname;                       // 文件名，指向fname_inline或文件名arena
+};
+
 /******************************************************************************
 * SECTION: FS Specific Structure - Disk structure
 *******************************************************************************/
+struct nfs_group_d
+{
+    int                free_inodes;         // 空闲inode数
+    int                free_blks;           // 空闲数据块数
+    int                nr_dirs;             // 目录数
+};
+
 struct nfs_super_d
 {
     // 幻数，用于判断是否为第一次读取磁盘
     uint32_t           magic_num;           // 幻数
     // 需与内存同步内容
-    int                sz_usage;            // 已用空间大小
+    int                journal_blks;        // 日志区占用的块数
+    int                journal_offset;      // 日志区在磁盘上的偏移
     
     int                map_inode_blks;      // inode位图占用的块数
     int                map_inode_offset;    // inode位图在磁盘上的偏移
@@ -163,8 +345,17 @@ struct nfs_super_d
     int                map_data_blks;       // data位图占用的块数
     int                map_data_offset;     // data位图在磁盘上的偏移
 
-    int                inode_offset;        // inode起始位置在磁盘上的偏移
-    int                data_offset;         // data起始位置在磁盘上的偏移
+    int                nr_groups;           // 块组数
+    int                inodes_per_group;    // 每个块组的inode数
+    int                data_per_group;      // 每个块组的数据块数
+    int                group_offset;        // 块组0在磁盘上的偏移
+
+    // 空闲统计，与位图在同一事务中记录日志，挂载时直接读取
+    int                free_inodes;         // 全局空闲inode数
+    int                free_blks;           // 全局空闲数据块数
+    struct nfs_group_d groups[NFS_GROUP_CNT];   // 各块组空闲统计
+
+    int                orphan_head;         // 孤儿链表首个ino，-1表示为空，挂载时据此继续回收
 };
 
 struct nfs_inode_d
@@ -174,15 +365,49 @@ struct nfs_inode_d
     int                size;                // 文件已占用空间
     NFS_FILE_TYPE      ftype;               // 文件类型（文件/目录）
     int                dir_cnt;             // 若为目录，目录项dentry数目
+    int                nlink;               // 链接数
+    uint32_t           mode;                // 权限位
+    uint32_t           uid;                 // 属主
+    uint32_t           gid;                 // 属组
+    struct timespec    atime;               // 访问时间（纳秒精度）
+    struct timespec    mtime;               // 内容修改时间
+    struct timespec    ctime;               // 属性修改时间
     int                blockno[NFS_DATA_PER_FILE]; // 指向的数据块在磁盘中的块号
+    uint32_t           unwritten;           // 第i位表示第i个数据块已预分配但未写入
+    int                next_orphan;         // 孤儿链表中下一个ino，-1表示链表尾
+    char               link[NFS_FAST_LINK_LEN];    // 短符号链接的目标，长目标存于第0个数据块
 };  
 
 struct nfs_dentry_d
 {   
-    // 需与内存同步内容
-    char               fname[NFS_MAX_FILE_NAME];    // 指向的inode的文件名
-    NFS_FILE_TYPE      ftype;                       // 指向的inode的文件类型
-    int                ino;                         // 指向的ino编号
+    // 变长记录，存于目录的数据块中，格式见newfs_dir.c
+    uint32_t           ino;                         // 指向的ino编号
+    uint16_t           rec_len;                     // 记录长度（含填充），即到下一条记录的距离
+    uint8_t            name_len;                    // 文件名长度，0表示空闲记录
+    uint8_t            ftype;                       // 指向的inode的文件类型
+    char               fname[];                     // 文件名，不以'\0'结尾
 };  
 
-#endif /* _TYPES_H_ */
\ No newline at end of file
+struct nfs_jnl_hdr_d
+{
+    // 日志区第0块，日志区格式见newfs_journal.c
+    uint32_t           magic;               // 幻数
+    uint32_t           seq;                 // 日志区第1块处应出现的事务序号
+};
+
+struct nfs_jnl_desc_d
+{
+    uint32_t           magic;               // 幻数
+    uint32_t           seq;                 // 事务序号
+    int                nr_blks;             // 事务中的块数
+    int                blknos[];            // 各块镜像的原位置块号
+};
+
+struct nfs_jnl_commit_d
+{
+    uint32_t           magic;               // 幻数
+    uint32_t           seq;                 // 事务序号
+    uint32_t           csum;                // 描述块与全部镜像的校验和
+};
+
+#endif /* _TYPES_H_ */
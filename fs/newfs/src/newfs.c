@@ -11,6 +11,9 @@ struct custom_options nfs_options;
 
 static const struct fuse_opt option_spec[] = {		/* 用于FUSE文件系统解析参数 */
 	OPTION("--device=%s", device),
+	{ "--relatime", offsetof(struct custom_options, atime), NFS_ATIME_RELATIME },
+	{ "--strictatime", offsetof(struct custom_options, atime), NFS_ATIME_STRICT },
+	{ "--noatime", offsetof(struct custom_options, atime), NFS_ATIME_NOATIME },
 	FUSE_OPT_END
 };
 
@@ -24,17 +27,28 @@ static struct fuse_operations operations = {
 	.getattr = nfs_getattr,				/* 获取文件属性，类似stat，必须完成 */
 	.readdir = nfs_readdir,				/* 填充dentrys */
 	.mknod = nfs_mknod,					/* 创建文件，touch相关 */
-	.write = NULL,						/* 写入文件 */
-	.read = NULL,						/* 读文件 */
-	.utimens = nfs_utimens,				/* 修改时间，忽略，避免touch报错 */
-	.truncate = NULL,					/* 改变文件大小 */
-	.unlink = NULL,						/* 删除文件 */
-	.rmdir	= NULL,						/* 删除目录， rm -r */
-	.rename = NULL,						/* 重命名，mv */
-
-	.open = NULL,							
-	.opendir = NULL,
-	.access = NULL
+	.write = nfs_write,					/* 写入文件 */
+	.read = nfs_read,					/* 读文件 */
+	.utimens = nfs_utimens,				/* 修改访问与修改时间，touch */
+	.chmod = nfs_chmod,					/* 修改权限 */
+	.chown = nfs_chown,					/* 修改属主与属组 */
+	.truncate = nfs_truncate,			/* 改变文件大小 */
+	.unlink = nfs_unlink,				/* 删除文件 */
+	.rmdir	= nfs_rmdir,				/* 删除目录， rm -r */
+	.rename = nfs_rename,				/* 重命名，mv */
+	.link = nfs_link,					/* 硬链接，ln */
+	.symlink = nfs_symlink,				/* 符号链接，ln -s */
+	.readlink = nfs_readlink,			/* 读取符号链接目标 */
+
+	.open = nfs_open,							
+	.opendir = nfs_opendir,
+	.access = nfs_access,
+	.flush = nfs_flush,					/* 关闭文件，写回数据 */
+	.fsync = nfs_fsync,					/* 同步文件，等待日志提交 */
+	.fsyncdir = nfs_fsyncdir,			/* 同步目录，等待日志提交 */
+	.statfs = nfs_statfs,				/* 空闲统计，df */
+	.fallocate = nfs_fallocate,			/* 预分配文件空间 */
+	.ioctl = nfs_ioctl					/* SEEK_DATA/SEEK_HOLE */
 };
 /******************************************************************************
 * SECTION: 必做函数实现
@@ -87,31 +101,66 @@ void nfs_destroy(void* p) {
  */
 int nfs_mkdir(const char* path, mode_t mode) {
 	/* TODO: 解析路径，创建目录 */
-	(void)mode;
 	boolean is_find, is_root;
 	char* fname;
+	struct nfs_dentry* last_dentry;
+	struct nfs_dentry* dentry;
+	struct nfs_inode*  inode;
+	// 以下查找与修改作为一个操作加入日志事务
+	nfs_jnl_begin();
 	// 寻找path对应文件/目录，若已存在则is_find为TRUE
 	// 若不存在，last_dentry为path匹配上的最后一级目录
 	// 期望为上一级父目录
-	struct nfs_dentry* last_dentry = nfs_lookup(path, &is_find, &is_root);
-	struct nfs_dentry* dentry;
-	struct nfs_inode*  inode;
+	last_dentry = nfs_lookup(path, &is_find, &is_root);
+	if (last_dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
 	// 目录已存在，报错
 	if (is_find) {
+		nfs_jnl_end();
 		return -NFS_ERROR_EXISTS;
 	}
-	// 父亲为文件类型，报错
-	if (NFS_IS_REG(last_dentry->inode)) {
+	// 父亲不是目录，报错
+	if (!NFS_IS_DIR(last_dentry->inode)) {
+		nfs_jnl_end();
 		return -NFS_ERROR_UNSUPPORTED;
 	}
 	// 创建新目录
 	fname  = nfs_get_fname(path);					// 从path中解析目录文件名
+	if (strlen(fname) >= NFS_MAX_FILE_NAME) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NAMETOOLONG;
+	}
+	if (!nfs_dir_has_room(last_dentry->inode, fname)) {	// 父目录块已满
+		nfs_jnl_end();
+		return -NFS_ERROR_NOSPACE;
+	}
 	dentry = new_dentry(fname, NFS_DIR); 			// 新建dentry
+	if (dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOMEM;
+	}
 	dentry->parent = last_dentry;					// 连接父目录
 	inode  = nfs_alloc_inode(dentry);				// 新建inode
+	if (inode == NULL) {							// inode或数据块耗尽
+		free_dentry(dentry);
+		nfs_jnl_end();
+		return -NFS_ERROR_NOSPACE;
+	}
+	inode->mode = mode & 07777;
 	nfs_alloc_dentry(last_dentry->inode, dentry);	// 为inode绑定dentry
-
-	return NFS_ERROR_NONE;	// return 0，成功返回
+	nfs_dir_add_rec(last_dentry->inode, dentry);	// 写入父目录块
+	last_dentry->inode->nlink++;					// 子目录链接父目录
+	nfs_touch_inode(last_dentry->inode, TRUE);
+	nfs_jnl_dirty_inode(last_dentry->inode);		// 父目录inode与目录块
+	nfs_jnl_dirty_inode(inode);						// 新目录inode与目录块
+	nfs_jnl_dirty_map_inode(inode->ino);
+	for (int i = 0; i < NFS_DATA_PER_FILE; i++) {
+		nfs_jnl_dirty_map_data(inode->blockno[i]);
+	}
+	nfs_jnl_dirty_super();							// 空闲统计
+	return nfs_jnl_end();	// return 0，成功返回
 }
 
 /**
@@ -124,37 +173,52 @@ int nfs_mkdir(const char* path, mode_t mode) {
 int nfs_getattr(const char* path, struct stat * nfs_stat) {
 	/* TODO: 解析路径，获取Inode，填充nfs_stat，可参考/fs/simplefs/sfs.c的sfs_getattr()函数实现 */
 	boolean	is_find, is_root;
+	struct nfs_dentry* dentry;
+	// 查找可能读入inode、修改内存目录树，与其他操作互斥
+	nfs_jnl_begin();
 	// 根据路径获得文件或目录的dentry，找到时is_find为true
-	struct nfs_dentry* dentry = nfs_lookup(path, &is_find, &is_root);
+	dentry = nfs_lookup(path, &is_find, &is_root);
+	if (dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
 	// 未找到，报错退出
 	if (is_find == FALSE) {
+		nfs_jnl_end();
 		return -NFS_ERROR_NOTFOUND;
 	}
 	// 若路径对应目录，设置nfs_stat中的属性st_mode与st_size
 	if (NFS_IS_DIR(dentry->inode)) {
-		nfs_stat->st_mode = S_IFDIR | NFS_DEFAULT_PERM;
-		nfs_stat->st_size = dentry->inode->dir_cnt * sizeof(struct nfs_dentry_d);
+		nfs_stat->st_mode = S_IFDIR | dentry->inode->mode;
+		nfs_stat->st_size = NFS_BLKS_SZ(NFS_DATA_PER_FILE);	// 目录块总大小
 	}
 	// 若路径对应文件，设置属性
 	else if (NFS_IS_REG(dentry->inode)) {
-		nfs_stat->st_mode = S_IFREG | NFS_DEFAULT_PERM;
+		nfs_stat->st_mode = S_IFREG | dentry->inode->mode;
+		nfs_stat->st_size = dentry->inode->size;
+	}
+	// 符号链接的大小为目标路径长度
+	else if (NFS_IS_SYM_LINK(dentry->inode)) {
+		nfs_stat->st_mode = S_IFLNK | dentry->inode->mode;
 		nfs_stat->st_size = dentry->inode->size;
 	}
 
-	nfs_stat->st_nlink = 1;
-	nfs_stat->st_uid 	 = getuid();
-	nfs_stat->st_gid 	 = getgid();
-	nfs_stat->st_atime   = time(NULL);
-	nfs_stat->st_mtime   = time(NULL);
+	nfs_stat->st_ino   = dentry->inode->ino;
+	nfs_stat->st_nlink = dentry->inode->nlink;
+	nfs_stat->st_uid 	 = dentry->inode->uid;
+	nfs_stat->st_gid 	 = dentry->inode->gid;
+	nfs_stat->st_atim    = dentry->inode->atime;
+	nfs_stat->st_mtim    = dentry->inode->mtime;
+	nfs_stat->st_ctim    = dentry->inode->ctime;
 	//nfs_stat->st_blksize = NFS_IO_SZ();
 	nfs_stat->st_blksize = NFS_BLK_SZ();
 
 	if (is_root) {
-		nfs_stat->st_size	= nfs_super.sz_usage; 
+		nfs_stat->st_size	= NFS_BLKS_SZ(nfs_super.max_data - nfs_super.free_blks);	// 已用空间大小
 		// nfs_stat->st_blocks = NFS_DISK_SZ() / NFS_IO_SZ();
 		nfs_stat->st_blocks = NFS_DISK_SZ() / NFS_BLK_SZ();
-		nfs_stat->st_nlink  = 2;		/* !特殊，根目录link数为2 */
 	}
+	nfs_jnl_end();
 	return NFS_ERROR_NONE;
 }
 
@@ -181,10 +245,16 @@ int nfs_readdir(const char * path, void * buf, fuse_fill_dir_t filler, off_t off
     /* TODO: 解析路径，获取目录的Inode，并读取目录项，利用filler填充到buf，可参考/fs/simplefs/sfs.c的sfs_readdir()函数实现 */
 	boolean	is_find, is_root;
 	int		cur_dir = offset;
-	// 根据路径获得dentry，找到时is_find为true
-	struct nfs_dentry* dentry = nfs_lookup(path, &is_find, &is_root);
+	struct nfs_dentry* dentry;
 	struct nfs_inode* inode;
 	struct nfs_dentry* sub_dentry;
+	nfs_jnl_begin();
+	// 根据路径获得dentry，找到时is_find为true
+	dentry = nfs_lookup(path, &is_find, &is_root);
+	if (dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
 	// 目标存在时
 	if (is_find) {
 		// dentry对应inode
@@ -194,8 +264,13 @@ int nfs_readdir(const char * path, void * buf, fuse_fill_dir_t filler, off_t off
 		if (sub_dentry) {
 			filler(buf, sub_dentry->fname, NULL, ++offset);
 		}
+		if (cur_dir == 0) {
+			nfs_update_atime(inode);
+		}
+		nfs_jnl_end();
 		return NFS_ERROR_NONE;
 	}
+	nfs_jnl_end();
 	return -NFS_ERROR_NOTFOUND;
 }
 
@@ -210,19 +285,39 @@ int nfs_readdir(const char * path, void * buf, fuse_fill_dir_t filler, off_t off
 int nfs_mknod(const char* path, mode_t mode, dev_t dev) {
 	/* TODO: 解析路径，并创建相应的文件 */
 	boolean	is_find, is_root;
-	// 寻找path对应文件/目录，若已存在则is_find为TRUE
-	// 若不存在，last_dentry为path匹配上的最后一级目录
-	// 期望为上一级的父目录
-	struct nfs_dentry* last_dentry = nfs_lookup(path, &is_find, &is_root);
+	struct nfs_dentry* last_dentry;
 	struct nfs_dentry* dentry;
 	struct nfs_inode* inode;
 	char* fname;
+	nfs_jnl_begin();
+	// 寻找path对应文件/目录，若已存在则is_find为TRUE
+	// 若不存在，last_dentry为path匹配上的最后一级目录
+	// 期望为上一级的父目录
+	last_dentry = nfs_lookup(path, &is_find, &is_root);
+	if (last_dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
 	// 目标已存在，报错
 	if (is_find == TRUE) {
+		nfs_jnl_end();
 		return -NFS_ERROR_EXISTS;
 	}
+	// 父亲不是目录，报错
+	if (!NFS_IS_DIR(last_dentry->inode)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_UNSUPPORTED;
+	}
 	// 获得文件名
 	fname = nfs_get_fname(path);
+	if (strlen(fname) >= NFS_MAX_FILE_NAME) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NAMETOOLONG;
+	}
+	if (!nfs_dir_has_room(last_dentry->inode, fname)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOSPACE;
+	}
 	// 根据mode新建dentry
 	if (S_ISREG(mode)) {
 		dentry = new_dentry(fname, NFS_REG_FILE);
@@ -230,27 +325,130 @@ int nfs_mknod(const char* path, mode_t mode, dev_t dev) {
 	else if (S_ISDIR(mode)) {
 		dentry = new_dentry(fname, NFS_DIR);
 	}
+	else {
+		nfs_jnl_end();
+		return -NFS_ERROR_UNSUPPORTED;
+	}
+	if (dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOMEM;
+	}
 	// 连接父目录
 	dentry->parent = last_dentry;
 	// 分配inode
 	inode = nfs_alloc_inode(dentry);
-	// 绑定inode与dentry
+	if (inode == NULL) {
+		free_dentry(dentry);
+		nfs_jnl_end();
+		return -NFS_ERROR_NOSPACE;
+	}
+	inode->mode = mode & 07777;
+	// 绑定inode与dentry，并写入父目录块
 	nfs_alloc_dentry(last_dentry->inode, dentry);
-
-	return NFS_ERROR_NONE;	// return 0，成功
+	nfs_dir_add_rec(last_dentry->inode, dentry);
+	if (NFS_IS_DIR(inode)) {
+		last_dentry->inode->nlink++;
+	}
+	nfs_touch_inode(last_dentry->inode, TRUE);
+	// 父目录、新inode与位图作为一个操作加入日志事务
+	nfs_jnl_dirty_inode(last_dentry->inode);
+	nfs_jnl_dirty_inode(inode);
+	nfs_jnl_dirty_map_inode(inode->ino);			// 文件数据块延迟到写回时分配
+	nfs_jnl_dirty_super();
+	return nfs_jnl_end();	// return 0，成功
 }
 
 /**
- * @brief 修改时间，为了不让touch报错 
+ * @brief 修改访问时间与修改时间，支持UTIME_NOW与UTIME_OMIT，ctime随之更新
  * 
  * @param path 相对于挂载点的路径
- * @param tv 实践
+ * @param tv tv[0]为atime，tv[1]为mtime
  * @return int 0成功，否则失败
  */
 int nfs_utimens(const char* path, const struct timespec tv[2]) {
-	(void)path;
-	return 0;
+	boolean	is_find, is_root;
+	struct nfs_dentry* dentry;
+	struct nfs_inode*  inode;
+	nfs_jnl_begin();
+	dentry = nfs_lookup(path, &is_find, &is_root);
+	if (dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
+	if (is_find == FALSE) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTFOUND;
+	}
+	inode = dentry->inode;
+	nfs_touch_inode(inode, FALSE);
+	if (tv[0].tv_nsec != UTIME_OMIT) {
+		inode->atime = tv[0].tv_nsec == UTIME_NOW ? inode->ctime : tv[0];
+	}
+	if (tv[1].tv_nsec != UTIME_OMIT) {
+		inode->mtime = tv[1].tv_nsec == UTIME_NOW ? inode->ctime : tv[1];
+	}
+	nfs_jnl_dirty_inode(inode);
+	return nfs_jnl_end();
 }
+
+/**
+ * @brief 修改权限位
+ * 
+ * @param path 相对于挂载点的路径
+ * @param mode 新的权限，文件类型位被忽略
+ * @return int 0成功，否则失败
+ */
+int nfs_chmod(const char* path, mode_t mode) {
+	boolean	is_find, is_root;
+	struct nfs_dentry* dentry;
+	nfs_jnl_begin();
+	dentry = nfs_lookup(path, &is_find, &is_root);
+	if (dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
+	if (is_find == FALSE) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTFOUND;
+	}
+	dentry->inode->mode = mode & 07777;
+	nfs_touch_inode(dentry->inode, FALSE);
+	nfs_jnl_dirty_inode(dentry->inode);
+	return nfs_jnl_end();
+}
+
+/**
+ * @brief 修改属主与属组
+ * 
+ * @param path 相对于挂载点的路径
+ * @param uid 新属主，(uid_t)-1表示不变
+ * @param gid 新属组，(gid_t)-1表示不变
+ * @return int 0成功，否则失败
+ */
+int nfs_chown(const char* path, uid_t uid, gid_t gid) {
+	boolean	is_find, is_root;
+	struct nfs_dentry* dentry;
+	nfs_jnl_begin();
+	dentry = nfs_lookup(path, &is_find, &is_root);
+	if (dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
+	if (is_find == FALSE) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTFOUND;
+	}
+	if (uid != (uid_t)-1) {
+		dentry->inode->uid = uid;
+	}
+	if (gid != (gid_t)-1) {
+		dentry->inode->gid = gid;
+	}
+	nfs_touch_inode(dentry->inode, FALSE);
+	nfs_jnl_dirty_inode(dentry->inode);
+	return nfs_jnl_end();
+}
+
 /******************************************************************************
 * SECTION: 选做函数实现
 *******************************************************************************/
@@ -266,7 +464,70 @@ int nfs_utimens(const char* path, const struct timespec tv[2]) {
  */
 int nfs_write(const char* path, const char* buf, size_t size, off_t offset,
 		        struct fuse_file_info* fi) {
-	/* 选做 */
+	boolean	is_find, is_root;
+	struct nfs_dentry* dentry;
+	struct nfs_inode*  inode;
+	int    max_size = NFS_BLKS_SZ(NFS_DATA_PER_FILE);
+	int    done     = 0;
+	int    nr_resv  = 0;
+	int    blk, blk_ofs, len;
+	int    first, last;
+	nfs_jnl_begin();
+	dentry = nfs_lookup(path, &is_find, &is_root);
+	if (dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
+	if (is_find == FALSE) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTFOUND;
+	}
+	inode = dentry->inode;
+	if (NFS_IS_DIR(inode)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_ISDIR;
+	}
+	// 文件大小固定上限，超出部分不写
+	if (offset >= max_size) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOSPACE;
+	}
+	if (offset + size > max_size) {
+		size = max_size - offset;
+	}
+	// 延迟分配：为将被弄脏且尚无磁盘块的块预留空闲块，写回时再一次分配；
+	// 文件尾与offset之间整块跳过的部分为空洞，不占用磁盘块
+	first = offset / NFS_BLK_SZ();
+	last  = (offset + size - 1) / NFS_BLK_SZ();
+	for (blk = first; blk <= last; blk++) {
+		if (inode->blockno[blk] == NFS_BLKNO_NONE && !(inode->block_flag[blk] & NFS_FLAG_BUF_DELAY)) {
+			nr_resv++;
+		}
+	}
+	if (nfs_resv_blocks(nr_resv) != NFS_ERROR_NONE) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOSPACE;
+	}
+	for (blk = first; blk <= last; blk++) {
+		if (inode->blockno[blk] == NFS_BLKNO_NONE) {
+			inode->block_flag[blk] |= NFS_FLAG_BUF_DELAY;
+		}
+	}
+	// 逐块写入缓冲区，只标记被写到的块，由fsync/flush/卸载写回
+	while (done < size) {
+		blk     = (offset + done) / NFS_BLK_SZ();
+		blk_ofs = (offset + done) % NFS_BLK_SZ();
+		len     = NFS_BLK_SZ() - blk_ofs < size - done ? NFS_BLK_SZ() - blk_ofs : size - done;
+		memcpy(inode->block_pointer[blk] + blk_ofs, buf + done, len);
+		inode->block_flag[blk] |= NFS_FLAG_BUF_DIRTY;
+		inode->block_flag[blk] &= ~NFS_FLAG_BUF_UNWRITTEN;	// 预分配的块写入后不再读为零
+		done += len;
+	}
+	if (offset + size > inode->size) {
+		inode->size = offset + size;
+	}
+	nfs_touch_inode(inode, TRUE);
+	nfs_jnl_end();
 	return size;
 }
 
@@ -282,19 +543,79 @@ int nfs_write(const char* path, const char* buf, size_t size, off_t offset,
  */
 int nfs_read(const char* path, char* buf, size_t size, off_t offset,
 		       struct fuse_file_info* fi) {
-	/* 选做 */
+	boolean	is_find, is_root;
+	struct nfs_dentry* dentry;
+	struct nfs_inode*  inode;
+	int    done = 0;
+	int    blk, blk_ofs, len;
+	nfs_jnl_begin();
+	dentry = nfs_lookup(path, &is_find, &is_root);
+	if (dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
+	if (is_find == FALSE) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTFOUND;
+	}
+	inode = dentry->inode;
+	if (NFS_IS_DIR(inode)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_ISDIR;
+	}
+	// 读到文件尾为止
+	if (offset >= inode->size) {
+		nfs_jnl_end();
+		return 0;
+	}
+	if (offset + size > inode->size) {
+		size = inode->size - offset;
+	}
+	while (done < size) {
+		blk     = (offset + done) / NFS_BLK_SZ();
+		blk_ofs = (offset + done) % NFS_BLK_SZ();
+		len     = NFS_BLK_SZ() - blk_ofs < size - done ? NFS_BLK_SZ() - blk_ofs : size - done;
+		// 空洞与预分配未写入的块直接填零
+		if (NFS_BLK_HAS_DATA(inode, blk)) {
+			memcpy(buf + done, inode->block_pointer[blk] + blk_ofs, len);
+		}
+		else {
+			memset(buf + done, 0, len);
+		}
+		done += len;
+	}
+	nfs_update_atime(inode);
+	nfs_jnl_end();
 	return size;			   
 }
 
 /**
  * @brief 删除文件
  * 
+ * 只从父目录摘除目录项，inode与数据块由回收线程在后台批量释放
+ * 
  * @param path 相对于挂载点的路径
  * @return int 0成功，否则失败
  */
 int nfs_unlink(const char* path) {
-	/* 选做 */
-	return 0;
+	boolean is_find, is_root;
+	struct nfs_dentry* dentry;
+	nfs_jnl_begin();
+	dentry = nfs_lookup(path, &is_find, &is_root);
+	if (dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
+	if (!is_find) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTFOUND;
+	}
+	if (NFS_IS_DIR(dentry->inode)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_ISDIR;
+	}
+	nfs_detach_dentry(dentry);
+	return nfs_jnl_end();
 }
 
 /**
@@ -305,25 +626,406 @@ int nfs_unlink(const char* path) {
  *  1) Step 1. rm ./tests/mnt/j/j
  *  2) Step 2. rm ./tests/mnt/j
  * 即，先删除最深层的文件，再删除目录文件本身
+ * 与unlink相同，摘除目录项后由回收线程释放
  * 
  * @param path 相对于挂载点的路径
  * @return int 0成功，否则失败
  */
 int nfs_rmdir(const char* path) {
-	/* 选做 */
-	return 0;
+	boolean is_find, is_root;
+	struct nfs_dentry* dentry;
+	nfs_jnl_begin();
+	dentry = nfs_lookup(path, &is_find, &is_root);
+	if (dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
+	if (!is_find) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTFOUND;
+	}
+	if (is_root) {
+		nfs_jnl_end();
+		return -NFS_ERROR_BUSY;
+	}
+	if (!NFS_IS_DIR(dentry->inode)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTDIR;
+	}
+	// 保持POSIX语义，只删除空目录；回收线程按子树释放，不依赖这一点
+	if (dentry->inode->dir_cnt > 0) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTEMPTY;
+	}
+	nfs_detach_dentry(dentry);
+	return nfs_jnl_end();
 }
 
 /**
  * @brief 重命名文件 
  * 
+ * 只在父目录间重新链接dentry，不复制inode与数据。目标已存在时原地将其目录项记录
+ * 改指源inode，被覆盖的inode交由回收线程释放。两个父目录的修改记录于同一操作，
+ * 崩溃后要么仍为旧名字，要么已完成替换
+ * 
  * @param from 源文件路径
  * @param to 目标文件路径
  * @return int 0成功，否则失败
  */
 int nfs_rename(const char* from, const char* to) {
-	/* 选做 */
-	return 0;
+	boolean is_find, is_root;
+	char* fname;
+	const char* name = NULL;
+	struct nfs_dentry* src;
+	struct nfs_dentry* dst;
+	struct nfs_dentry* dst_parent;
+	struct nfs_dentry* cursor;
+	struct nfs_inode*  src_dir;
+	struct nfs_inode*  dst_dir;
+	nfs_jnl_begin();
+	src = nfs_lookup(from, &is_find, &is_root);
+	if (src == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
+	if (!is_find) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTFOUND;
+	}
+	if (is_root) {
+		nfs_jnl_end();
+		return -NFS_ERROR_BUSY;
+	}
+	is_find = FALSE;
+	dst = nfs_lookup(to, &is_find, &is_root);
+	if (dst == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
+	if (is_root) {
+		nfs_jnl_end();
+		return -NFS_ERROR_BUSY;
+	}
+	if (is_find) {
+		dst_parent = dst->parent;
+	}
+	else {
+		dst_parent = dst;
+		dst        = NULL;
+	}
+	// 目标的上一级须是已存在的目录
+	if (!NFS_IS_DIR(dst_parent->inode)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTDIR;
+	}
+	if (!nfs_is_parent(dst_parent, to)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTFOUND;
+	}
+	// 同一文件的两个名字，什么也不做
+	if (dst == src || (dst != NULL && dst->inode == src->inode)) {
+		return nfs_jnl_end();
+	}
+	// 目录不能移入自身的子树
+	for (cursor = dst_parent; cursor != NULL; cursor = cursor->parent) {
+		if (cursor == src) {
+			nfs_jnl_end();
+			return -NFS_ERROR_INVAL;
+		}
+	}
+	fname = nfs_get_fname(to);
+	if (strlen(fname) >= NFS_MAX_FILE_NAME) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NAMETOOLONG;
+	}
+	src_dir = src->parent->inode;
+	dst_dir = dst_parent->inode;
+	if (dst != NULL) {
+		if (NFS_IS_DIR(src->inode) && !NFS_IS_DIR(dst->inode)) {
+			nfs_jnl_end();
+			return -NFS_ERROR_NOTDIR;
+		}
+		if (!NFS_IS_DIR(src->inode) && NFS_IS_DIR(dst->inode)) {
+			nfs_jnl_end();
+			return -NFS_ERROR_ISDIR;
+		}
+		if (NFS_IS_DIR(dst->inode) && dst->inode->dir_cnt > 0) {
+			nfs_jnl_end();
+			return -NFS_ERROR_NOTEMPTY;
+		}
+	}
+	// 修改目录记录前先取得新长文件名的引用，内存不足时什么也没有改变
+	if (strlen(fname) >= NFS_INLINE_NAME_LEN) {
+		name = nfs_name_intern(&nfs_super.name_arena, fname, strlen(fname),
+							   nfs_hash_name(fname, strlen(fname)));
+		if (name == NULL) {
+			nfs_jnl_end();
+			return -NFS_ERROR_NOMEM;
+		}
+	}
+	if (dst != NULL) {
+		// 目标记录文件名不变，原地改指源inode，再删除源记录
+		nfs_dir_set_rec(dst_dir, dst, src);
+		nfs_dir_del_rec(src_dir, src);
+		nfs_drop_dentry(src_dir, src);
+		nfs_drop_dentry(dst_dir, dst);
+		nfs_put_dentry(dst);						// 被覆盖的名字
+	}
+	else {
+		nfs_dir_del_rec(src_dir, src);
+		if (!nfs_dir_has_room(dst_dir, fname)) {	// 目标目录块已满，恢复源记录
+			nfs_dir_add_rec(src_dir, src);
+			if (name != NULL) {
+				nfs_name_put(&nfs_super.name_arena, name);
+			}
+			nfs_jnl_end();
+			return -NFS_ERROR_NOSPACE;
+		}
+		nfs_drop_dentry(src_dir, src);
+	}
+	// 目录换到新的父目录下
+	if (NFS_IS_DIR(src->inode)) {
+		src_dir->nlink--;
+		dst_dir->nlink++;
+	}
+	// 重新链接dentry，其inode与子目录项保持不变。新文件名已驻留，设置时不会失败
+	nfs_dentry_set_name(src, fname);
+	if (name != NULL) {
+		nfs_name_put(&nfs_super.name_arena, name);
+	}
+	src->parent  = dst_parent;
+	src->brother = NULL;
+	nfs_alloc_dentry(dst_dir, src);
+	if (dst == NULL) {
+		nfs_dir_add_rec(dst_dir, src);
+	}
+	nfs_touch_inode(src->inode, FALSE);
+	nfs_touch_inode(src_dir, TRUE);
+	nfs_touch_inode(dst_dir, TRUE);
+	nfs_jnl_dirty_inode(src->inode);				// ctime
+	nfs_jnl_dirty_inode(src_dir);					// 只记录被修改的目录块
+	if (dst_dir != src_dir) {
+		nfs_jnl_dirty_inode(dst_dir);
+	}
+	return nfs_jnl_end();
+}
+
+/**
+ * @brief 创建硬链接，新名字与from共享同一inode，数据只存一份
+ * 
+ * @param from 已存在的文件路径
+ * @param to 新名字的路径
+ * @return int 0成功，否则失败
+ */
+int nfs_link(const char* from, const char* to) {
+	boolean is_find, is_root;
+	char* fname;
+	struct nfs_dentry* src;
+	struct nfs_dentry* last_dentry;
+	struct nfs_dentry* dentry;
+	nfs_jnl_begin();
+	src = nfs_lookup(from, &is_find, &is_root);
+	if (src == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
+	if (!is_find) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTFOUND;
+	}
+	// 不允许目录的硬链接
+	if (NFS_IS_DIR(src->inode)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_PERM;
+	}
+	is_find = FALSE;
+	last_dentry = nfs_lookup(to, &is_find, &is_root);
+	if (last_dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
+	if (is_find) {
+		nfs_jnl_end();
+		return -NFS_ERROR_EXISTS;
+	}
+	if (!NFS_IS_DIR(last_dentry->inode)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTDIR;
+	}
+	if (!nfs_is_parent(last_dentry, to)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTFOUND;
+	}
+	fname = nfs_get_fname(to);
+	if (strlen(fname) >= NFS_MAX_FILE_NAME) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NAMETOOLONG;
+	}
+	if (!nfs_dir_has_room(last_dentry->inode, fname)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOSPACE;
+	}
+	dentry         = new_dentry(fname, src->inode->ftype);
+	if (dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOMEM;
+	}
+	dentry->parent = last_dentry;
+	dentry->ino    = src->inode->ino;
+	dentry->inode  = src->inode;
+	nfs_alloc_dentry(last_dentry->inode, dentry);
+	nfs_dir_add_rec(last_dentry->inode, dentry);
+	src->inode->nlink++;
+	nfs_touch_inode(src->inode, FALSE);
+	nfs_touch_inode(last_dentry->inode, TRUE);
+	nfs_jnl_dirty_inode(last_dentry->inode);		// 父目录inode与目录块
+	nfs_jnl_dirty_inode(src->inode);				// 链接数
+	return nfs_jnl_end();
+}
+
+/**
+ * @brief 创建符号链接。短目标内联存于inode，不占数据块；
+ * 长目标存于一个数据块，创建时立即分配并写入
+ * 
+ * @param target 链接目标，原样保存，不做解析
+ * @param path 相对于挂载点的路径
+ * @return int 0成功，否则失败
+ */
+int nfs_symlink(const char* target, const char* path) {
+	boolean	is_find, is_root;
+	struct nfs_dentry* last_dentry;
+	struct nfs_dentry* dentry;
+	struct nfs_inode* inode;
+	char* fname;
+	int len = strlen(target);
+	int blkno;
+	// 目标连同'\0'须放入一个数据块
+	if (len >= NFS_BLK_SZ()) {
+		return -NFS_ERROR_NAMETOOLONG;
+	}
+	nfs_jnl_begin();
+	last_dentry = nfs_lookup(path, &is_find, &is_root);
+	if (last_dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
+	if (is_find == TRUE) {
+		nfs_jnl_end();
+		return -NFS_ERROR_EXISTS;
+	}
+	if (!NFS_IS_DIR(last_dentry->inode)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTDIR;
+	}
+	if (!nfs_is_parent(last_dentry, path)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTFOUND;
+	}
+	fname = nfs_get_fname(path);
+	if (strlen(fname) >= NFS_MAX_FILE_NAME) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NAMETOOLONG;
+	}
+	if (!nfs_dir_has_room(last_dentry->inode, fname)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOSPACE;
+	}
+	// 长目标先占用一个数据块，靠近父目录所在块组
+	blkno = NFS_BLKNO_NONE;
+	if (len >= NFS_FAST_LINK_LEN) {
+		blkno = nfs_new_block(NFS_INO_GROUP(last_dentry->ino) * nfs_super.data_per_group);
+		if (blkno < 0) {
+			nfs_jnl_end();
+			return blkno;
+		}
+	}
+	dentry = new_dentry(fname, NFS_SYM_LINK);
+	if (dentry == NULL) {
+		if (blkno != NFS_BLKNO_NONE) {
+			nfs_free_block(blkno);
+		}
+		nfs_jnl_end();
+		return -NFS_ERROR_NOMEM;
+	}
+	dentry->parent = last_dentry;
+	inode = nfs_alloc_inode(dentry);
+	if (inode == NULL) {
+		if (blkno != NFS_BLKNO_NONE) {
+			nfs_free_block(blkno);
+		}
+		free_dentry(dentry);
+		nfs_jnl_end();
+		return -NFS_ERROR_NOSPACE;
+	}
+	// 目标常驻内存中的第0块缓冲区，readlink不需要读盘
+	inode->size = len;
+	memcpy(inode->block_pointer[0], target, len + 1);
+	if (blkno != NFS_BLKNO_NONE) {
+		// 数据块先于引用它的inode落盘，与文件数据的写回顺序一致
+		inode->blockno[0] = blkno;
+		if (nfs_driver_write(NFS_DATA_OFS(blkno), inode->block_pointer[0],
+							 NFS_BLKS_SZ(1)) != NFS_ERROR_NONE) {
+			// 与空间不足时一样回滚：归还数据块与inode，释放dentry
+			nfs_free_block(blkno);
+			nfs_free_inode(inode->ino, FALSE);
+			nfs_super.icache[inode->ino] = NULL;
+			for (int i = 0; i < NFS_DATA_PER_FILE; i++) {
+				nfs_slab_free(&nfs_super.blk_slab, inode->block_pointer[i]);
+			}
+			nfs_slab_free(&nfs_super.inode_slab, inode);
+			free_dentry(dentry);
+			nfs_jnl_end();
+			return -NFS_ERROR_IO;
+		}
+		nfs_jnl_dirty_map_data(blkno);
+	}
+	nfs_alloc_dentry(last_dentry->inode, dentry);
+	nfs_dir_add_rec(last_dentry->inode, dentry);
+	nfs_touch_inode(last_dentry->inode, TRUE);
+	nfs_jnl_dirty_inode(last_dentry->inode);
+	nfs_jnl_dirty_inode(inode);
+	nfs_jnl_dirty_map_inode(inode->ino);
+	nfs_jnl_dirty_super();
+	return nfs_jnl_end();
+}
+
+/**
+ * @brief 读取符号链接的目标，超出size时截断，结果总以'\0'结尾
+ * 
+ * @param path 相对于挂载点的路径
+ * @param buf 输出buffer
+ * @param size buffer大小
+ * @return int 0成功，否则失败
+ */
+int nfs_readlink(const char* path, char* buf, size_t size) {
+	boolean	is_find, is_root;
+	struct nfs_dentry* dentry;
+	struct nfs_inode*  inode;
+	size_t len;
+	nfs_jnl_begin();
+	dentry = nfs_lookup(path, &is_find, &is_root);
+	if (dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
+	if (is_find == FALSE) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTFOUND;
+	}
+	inode = dentry->inode;
+	if (!NFS_IS_SYM_LINK(inode)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_INVAL;
+	}
+	if (size == 0) {
+		nfs_jnl_end();
+		return NFS_ERROR_NONE;
+	}
+	len = inode->size < size - 1 ? inode->size : size - 1;
+	memcpy(buf, inode->block_pointer[0], len);
+	buf[len] = '\0';
+	nfs_update_atime(inode);
+	return nfs_jnl_end();
 }
 
 /**
@@ -335,8 +1037,7 @@ int nfs_rename(const char* from, const char* to) {
  * @return int 0成功，否则失败
  */
 int nfs_open(const char* path, struct fuse_file_info* fi) {
-	/* 选做 */
-	return 0;
+	return NFS_ERROR_NONE;
 }
 
 /**
@@ -347,8 +1048,7 @@ int nfs_open(const char* path, struct fuse_file_info* fi) {
  * @return int 0成功，否则失败
  */
 int nfs_opendir(const char* path, struct fuse_file_info* fi) {
-	/* 选做 */
-	return 0;
+	return NFS_ERROR_NONE;
 }
 
 /**
@@ -359,8 +1059,43 @@ int nfs_opendir(const char* path, struct fuse_file_info* fi) {
  * @return int 0成功，否则失败
  */
 int nfs_truncate(const char* path, off_t offset) {
-	/* 选做 */
-	return 0;
+	boolean	is_find, is_root;
+	struct nfs_dentry* dentry;
+	struct nfs_inode*  inode;
+	int    blknos[NFS_DATA_PER_FILE];
+	int    cnt;
+	if (offset < 0) {
+		return -NFS_ERROR_INVAL;
+	}
+	if (offset > NFS_BLKS_SZ(NFS_DATA_PER_FILE)) {
+		return -NFS_ERROR_FBIG;
+	}
+	nfs_jnl_begin();
+	dentry = nfs_lookup(path, &is_find, &is_root);
+	if (dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
+	if (is_find == FALSE) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTFOUND;
+	}
+	inode = dentry->inode;
+	if (NFS_IS_DIR(inode)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_ISDIR;
+	}
+	// 新文件尾之后的块批量归还数据位图，inode、位图与空闲统计作为一个操作记录
+	cnt = nfs_truncate_data(inode, offset, blknos);
+	nfs_touch_inode(inode, TRUE);
+	nfs_jnl_dirty_inode(inode);
+	for (int i = 0; i < cnt; i++) {
+		nfs_jnl_dirty_map_data(blknos[i]);
+	}
+	if (cnt > 0) {
+		nfs_jnl_dirty_super();
+	}
+	return nfs_jnl_end();
 }
 
 
@@ -377,9 +1112,287 @@ int nfs_truncate(const char* path, off_t offset) {
  * @return int 0成功，否则失败
  */
 int nfs_access(const char* path, int type) {
-	/* 选做: 解析路径，判断是否存在 */
-	return 0;
-}	
+	boolean	is_find, is_root;
+	nfs_jnl_begin();
+	if (nfs_lookup(path, &is_find, &is_root) == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
+	nfs_jnl_end();
+	// 全权限打开，只需判断是否存在
+	if (is_find == FALSE) {
+		return -NFS_ERROR_NOTFOUND;
+	}
+	return NFS_ERROR_NONE;
+}
+
+/**
+ * @brief 写回文件的脏数据块，并把inode记入日志事务
+ * 
+ * 先写数据再记录inode，保证事务提交时inode所指的数据已在磁盘上
+ * 
+ * @param path 相对于挂载点的路径
+ * @param seq 返回需等待提交的事务序号
+ * @return int 0成功，否则失败
+ */
+static int nfs_sync_path(const char* path, uint32_t* seq) {
+	boolean	is_find, is_root;
+	struct nfs_dentry* dentry;
+	struct nfs_inode*  inode;
+	int    ret = NFS_ERROR_NONE;
+	nfs_jnl_begin();
+	dentry = nfs_lookup(path, &is_find, &is_root);
+	if (dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
+	if (is_find == FALSE) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTFOUND;
+	}
+	inode = dentry->inode;
+	if (NFS_IS_REG(inode)) {
+		// 文件长度已确定，为延迟分配的数据一次分配连续的块，位图与空闲统计随inode一同记录
+		ret = nfs_alloc_data(inode);
+		if (ret > 0) {
+			inode->dirty = TRUE;
+			for (int i = 0; i < NFS_DATA_PER_FILE; i++) {
+				if (inode->blockno[i] != NFS_BLKNO_NONE) {
+					nfs_jnl_dirty_map_data(inode->blockno[i]);
+				}
+			}
+			nfs_jnl_dirty_super();
+		}
+		if (ret >= 0) {
+			ret = nfs_sync_data(inode);
+		}
+	}
+	if (ret == NFS_ERROR_NONE) {
+		// 只记录属性有修改的inode块，目录还会记录其脏目录块；只读打开后关闭不产生日志
+		if (inode->dirty) {
+			nfs_jnl_dirty_inode(inode);
+		}
+		// 父目录中的目录项与该inode创建于同一事务，仍有未记录的修改时一并记录
+		if (dentry->parent != NULL && dentry->parent->inode != NULL) {
+			for (int i = 0; i < NFS_DATA_PER_FILE; i++) {
+				if (dentry->parent->inode->block_flag[i] & NFS_FLAG_BUF_DIRTY) {
+					nfs_jnl_dirty_inode(dentry->parent->inode);
+					break;
+				}
+			}
+		}
+		*seq = inode->jnl_seq;
+	}
+	nfs_jnl_end();
+	return ret;
+}
+
+/**
+ * @brief 关闭文件时调用，写回数据并记入日志，不等待提交
+ * 
+ * @param path 相对于挂载点的路径
+ * @param fi 可忽略
+ * @return int 0成功，否则失败
+ */
+int nfs_flush(const char* path, struct fuse_file_info* fi) {
+	uint32_t seq;
+	return nfs_sync_path(path, &seq);
+}
+
+/**
+ * @brief 同步文件，返回时数据与元数据均已落盘
+ * 
+ * 并发的fsync加入同一运行事务，由其中一个调用者提交，合并为一次日志写
+ * 
+ * @param path 相对于挂载点的路径
+ * @param datasync 可忽略，元数据与数据一并同步
+ * @param fi 可忽略
+ * @return int 0成功，否则失败
+ */
+int nfs_fsync(const char* path, int datasync, struct fuse_file_info* fi) {
+	uint32_t seq;
+	int      ret = nfs_sync_path(path, &seq);
+	if (ret != NFS_ERROR_NONE) {
+		return ret;
+	}
+	return nfs_jnl_wait(seq);
+}
+
+/**
+ * @brief 同步目录，返回时目录块已落盘
+ * 
+ * @param path 相对于挂载点的路径
+ * @param datasync 可忽略
+ * @param fi 可忽略
+ * @return int 0成功，否则失败
+ */
+int nfs_fsyncdir(const char* path, int datasync, struct fuse_file_info* fi) {
+	return nfs_fsync(path, datasync, fi);
+}
+
+/**
+ * @brief 获取文件系统空闲统计，df使用
+ * 
+ * 直接返回分配器维护的空闲计数，无需扫描位图
+ * 
+ * @param path 可忽略
+ * @param nfs_statvfs 返回的统计信息
+ * @return int 0成功
+ */
+int nfs_statfs(const char* path, struct statvfs* nfs_statvfs) {
+	nfs_jnl_begin();
+	memset(nfs_statvfs, 0, sizeof(struct statvfs));
+	nfs_statvfs->f_bsize   = NFS_BLK_SZ();
+	nfs_statvfs->f_frsize  = NFS_BLK_SZ();
+	nfs_statvfs->f_blocks  = nfs_super.max_data;
+	nfs_statvfs->f_bfree   = nfs_super.free_blks - nfs_super.resv_blks;	// 延迟分配预留的块视为已用
+	nfs_statvfs->f_bavail  = nfs_super.free_blks - nfs_super.resv_blks;
+	nfs_statvfs->f_files   = nfs_super.max_ino;
+	nfs_statvfs->f_ffree   = nfs_super.free_inodes;
+	nfs_statvfs->f_favail  = nfs_super.free_inodes;
+	nfs_statvfs->f_namemax = NFS_MAX_FILE_NAME - 1;
+	nfs_jnl_end();
+	return NFS_ERROR_NONE;
+}
+
+/**
+ * @brief 为文件预分配[offset, offset + length)内的数据块
+ * 
+ * 尚无磁盘块的块一次分配连续的一段，未写入前读取为零且不访问磁盘；
+ * 带FALLOC_FL_KEEP_SIZE时不改变文件大小
+ * 
+ * @param path 相对于挂载点的路径
+ * @param mode 仅支持0与FALLOC_FL_KEEP_SIZE
+ * @param offset 起始偏移
+ * @param length 长度
+ * @param fi 可忽略
+ * @return int 0成功，否则失败
+ */
+int nfs_fallocate(const char* path, int mode, off_t offset, off_t length,
+				  struct fuse_file_info* fi) {
+	boolean	is_find, is_root;
+	struct nfs_dentry* dentry;
+	struct nfs_inode*  inode;
+	int    ret;
+	if (mode & ~FALLOC_FL_KEEP_SIZE) {
+		return -EOPNOTSUPP;
+	}
+	if (offset < 0 || length <= 0) {
+		return -NFS_ERROR_INVAL;
+	}
+	nfs_jnl_begin();
+	dentry = nfs_lookup(path, &is_find, &is_root);
+	if (dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
+	if (is_find == FALSE) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTFOUND;
+	}
+	inode = dentry->inode;
+	if (NFS_IS_DIR(inode)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_ISDIR;
+	}
+	if (offset + length > NFS_BLKS_SZ(NFS_DATA_PER_FILE)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOSPACE;
+	}
+	ret = nfs_prealloc_data(inode, offset / NFS_BLK_SZ(),
+							NFS_ROUND_UP(offset + length, NFS_BLK_SZ()) / NFS_BLK_SZ());
+	if (ret < 0) {
+		nfs_jnl_end();
+		return ret;
+	}
+	if (!(mode & FALLOC_FL_KEEP_SIZE) && offset + length > inode->size) {
+		inode->size = offset + length;
+		nfs_touch_inode(inode, TRUE);
+	}
+	else {
+		nfs_touch_inode(inode, FALSE);
+	}
+	// 延迟分配的块在此一并分配，其数据需先写回，再与位图一同记录
+	ret = nfs_sync_data(inode);
+	if (ret == NFS_ERROR_NONE) {
+		nfs_jnl_dirty_inode(inode);
+		for (int i = 0; i < NFS_DATA_PER_FILE; i++) {
+			if (inode->blockno[i] != NFS_BLKNO_NONE) {
+				nfs_jnl_dirty_map_data(inode->blockno[i]);
+			}
+		}
+		nfs_jnl_dirty_super();
+	}
+	nfs_jnl_end();
+	return ret;
+}
+
+/**
+ * @brief 文件ioctl，目前仅支持NFS_IOC_SEEK
+ * 
+ * FUSE 2.x没有lseek回调，SEEK_DATA/SEEK_HOLE经NFS_IOC_SEEK完成：
+ * 传入struct nfs_ioc_seek的offset与whence，返回下一个数据或空洞的起始偏移。
+ * 空洞与预分配未写入的块视为空洞，文件尾视为隐含的空洞
+ * 
+ * @param path 相对于挂载点的路径
+ * @param cmd 命令号
+ * @param arg 可忽略
+ * @param fi 可忽略
+ * @param flags 可忽略
+ * @param data 命令数据，NFS_IOC_SEEK时为struct nfs_ioc_seek
+ * @return int 0成功，否则失败
+ */
+int nfs_ioctl(const char* path, int cmd, void* arg, struct fuse_file_info* fi,
+			  unsigned int flags, void* data) {
+	boolean	is_find, is_root;
+	struct nfs_dentry*   dentry;
+	struct nfs_inode*    inode;
+	struct nfs_ioc_seek* req = (struct nfs_ioc_seek *)data;
+	int    blk;
+	if (cmd != (int)NFS_IOC_SEEK) {
+		return -ENOTTY;
+	}
+	if (req->whence != SEEK_DATA && req->whence != SEEK_HOLE) {
+		return -NFS_ERROR_INVAL;
+	}
+	nfs_jnl_begin();
+	dentry = nfs_lookup(path, &is_find, &is_root);
+	if (dentry == NULL) {
+		nfs_jnl_end();
+		return -NFS_ERROR_IO;
+	}
+	if (is_find == FALSE) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NOTFOUND;
+	}
+	inode = dentry->inode;
+	if (NFS_IS_DIR(inode)) {
+		nfs_jnl_end();
+		return -NFS_ERROR_ISDIR;
+	}
+	if (req->offset < 0 || req->offset >= inode->size) {
+		nfs_jnl_end();
+		return -NFS_ERROR_NXIO;
+	}
+	for (blk = req->offset / NFS_BLK_SZ(); NFS_BLKS_SZ(blk) < inode->size; blk++) {
+		if ((NFS_BLK_HAS_DATA(inode, blk) != 0) == (req->whence == SEEK_DATA)) {
+			break;
+		}
+	}
+	// 之后没有数据；空洞则为文件尾
+	if (NFS_BLKS_SZ(blk) >= inode->size) {
+		if (req->whence == SEEK_DATA) {
+			nfs_jnl_end();
+			return -NFS_ERROR_NXIO;
+		}
+		req->offset = inode->size;
+	}
+	else if (NFS_BLKS_SZ(blk) > req->offset) {
+		req->offset = NFS_BLKS_SZ(blk);
+	}
+	nfs_jnl_end();
+	return NFS_ERROR_NONE;
+}
 /******************************************************************************
 * SECTION: FUSE入口
 *******************************************************************************/
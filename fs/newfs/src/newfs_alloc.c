@@ -0,0 +1,405 @@
+#include "../include/newfs.h"
+
+extern struct nfs_super      nfs_super;
+
+/**
+ * 块组分配器（ext2风格，位图集中存放）
+ *
+ * | Inode Map(G) | Data Map(G) | Group 0: Inode | DATA | Group 1: Inode | DATA | ... |
+ *
+ * 1) 第g个块组的inode位图与数据位图分别是两个位图区的第g块
+ * 2) ino与数据块号全局编号，ino / inodes_per_group即所在块组
+ * 3) 文件的inode放在父目录所在块组，数据块放在inode所在块组，块组满时顺延
+ * 4) 新目录分散到空闲inode较多、目录较少的块组
+ * 5) 各块组与全局的空闲计数随分配释放增量维护，并持久化在超级块中
+ * 6) 普通文件延迟分配：写入时只预留块数，写回时按文件长度一次分配连续的一段
+ */
+
+// 位图操作，bit为在位图区中的位下标
+static boolean nfs_map_test(uint8_t* map, int bit) {
+    return (map[bit / UINT8_BITS] & (0x1 << (bit % UINT8_BITS))) != 0;
+}
+static void nfs_map_set(uint8_t* map, int bit) {
+    map[bit / UINT8_BITS] |= (0x1 << (bit % UINT8_BITS));
+}
+static void nfs_map_clear(uint8_t* map, int bit) {
+    map[bit / UINT8_BITS] &= (uint8_t)(~(0x1 << (bit % UINT8_BITS)));
+}
+// 块组g的位图在位图区中的起始位下标
+#define NFS_GROUP_MAP_BIT(g)    ((g) * NFS_BLK_SZ() * UINT8_BITS)
+
+// 扫描位图，重新统计块组g的空闲inode与空闲数据块
+static void nfs_group_scan(int g) {
+    struct nfs_group* group = &nfs_super.groups[g];
+    group->free_inodes = nfs_super.inodes_per_group;
+    group->free_blks   = nfs_super.data_per_group;
+    for (int i = 0; i < nfs_super.inodes_per_group; i++) {
+        if (nfs_map_test(nfs_super.map_inode, NFS_GROUP_MAP_BIT(g) + i)) {
+            group->free_inodes--;
+        }
+    }
+    for (int i = 0; i < nfs_super.data_per_group; i++) {
+        if (nfs_map_test(nfs_super.map_data, NFS_GROUP_MAP_BIT(g) + i)) {
+            group->free_blks--;
+        }
+    }
+}
+
+/**
+ * @brief 建立各块组与全局的空闲统计，挂载时调用
+ *
+ * 超级块中的统计与位图在同一事务中记录日志，正常情况下直接载入；
+ * 新格式化的磁盘或统计值越界时扫描位图重建（目录数无法由位图得到，重建后为0）
+ *
+ * @param groups_d 超级块中的块组统计，为NULL时扫描位图
+ * @return int 0成功，否则失败
+ */
+int nfs_groups_init(const struct nfs_group_d* groups_d) {
+    struct nfs_group* group;
+    nfs_super.groups = (struct nfs_group *)calloc(nfs_super.nr_groups, sizeof(struct nfs_group));
+    if (nfs_super.groups == NULL) {
+        return -NFS_ERROR_NOSPACE;
+    }
+    nfs_super.free_inodes = 0;
+    nfs_super.free_blks   = 0;
+    nfs_super.resv_blks   = 0;
+    for (int g = 0; g < nfs_super.nr_groups; g++) {
+        group = &nfs_super.groups[g];
+        if (groups_d != NULL &&
+            groups_d[g].free_inodes >= 0 && groups_d[g].free_inodes <= nfs_super.inodes_per_group &&
+            groups_d[g].free_blks >= 0 && groups_d[g].free_blks <= nfs_super.data_per_group &&
+            groups_d[g].nr_dirs >= 0) {
+            group->free_inodes = groups_d[g].free_inodes;
+            group->free_blks   = groups_d[g].free_blks;
+            group->nr_dirs     = groups_d[g].nr_dirs;
+        }
+        else {
+            nfs_group_scan(g);
+        }
+        nfs_super.free_inodes += group->free_inodes;
+        nfs_super.free_blks   += group->free_blks;
+    }
+    return NFS_ERROR_NONE;
+}
+
+/**
+ * @brief 将各块组统计填入超级块，同步与写日志共用
+ *
+ * @param groups_d 超级块中的块组统计
+ */
+void nfs_groups_pack(struct nfs_group_d* groups_d) {
+    for (int g = 0; g < nfs_super.nr_groups; g++) {
+        groups_d[g].free_inodes = nfs_super.groups[g].free_inodes;
+        groups_d[g].free_blks   = nfs_super.groups[g].free_blks;
+        groups_d[g].nr_dirs     = nfs_super.groups[g].nr_dirs;
+    }
+}
+
+/**
+ * @brief 释放块组统计信息，卸载时调用
+ */
+void nfs_groups_destroy() {
+    free(nfs_super.groups);
+    nfs_super.groups = NULL;
+}
+
+/**
+ * @brief 为新目录选择块组：在空闲inode不低于平均值的块组中，选目录最少的，
+ * 目录数相同时选空闲块最多的
+ *
+ * @return int 块组号，无空闲inode时为-1
+ */
+static int nfs_find_group_dir() {
+    struct nfs_group* group;
+    int total_free = 0;
+    int avg_free;
+    int best = -1;
+    for (int g = 0; g < nfs_super.nr_groups; g++) {
+        total_free += nfs_super.groups[g].free_inodes;
+    }
+    if (total_free == 0) {
+        return -1;
+    }
+    avg_free = total_free / nfs_super.nr_groups;
+    for (int g = 0; g < nfs_super.nr_groups; g++) {
+        group = &nfs_super.groups[g];
+        if (group->free_inodes == 0 || group->free_inodes < avg_free) {
+            continue;
+        }
+        if (best < 0 || group->nr_dirs < nfs_super.groups[best].nr_dirs ||
+            (group->nr_dirs == nfs_super.groups[best].nr_dirs &&
+             group->free_blks > nfs_super.groups[best].free_blks)) {
+            best = g;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief 为普通文件选择块组：优先父目录所在块组，否则向后找同时有空闲inode与数据块的块组
+ *
+ * @param parent_group 父目录所在块组
+ * @return int 块组号，无空闲inode时为-1
+ */
+static int nfs_find_group_other(int parent_group) {
+    int g;
+    for (int i = 0; i < nfs_super.nr_groups; i++) {
+        g = (parent_group + i) % nfs_super.nr_groups;
+        if (nfs_super.groups[g].free_inodes > 0 && nfs_super.groups[g].free_blks > 0) {
+            return g;
+        }
+    }
+    for (g = 0; g < nfs_super.nr_groups; g++) {
+        if (nfs_super.groups[g].free_inodes > 0) {
+            return g;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 分配一个inode编号，占用inode位图
+ *
+ * @param parent_ino 父目录ino，根目录传-1
+ * @param is_dir 是否为目录
+ * @return int ino，空间不足时为-NFS_ERROR_NOSPACE
+ */
+int nfs_new_inode(int parent_ino, boolean is_dir) {
+    int g;
+    if (parent_ino < 0) {
+        g = 0;                                  // 根目录固定在块组0
+    }
+    else if (is_dir) {
+        g = nfs_find_group_dir();
+    }
+    else {
+        g = nfs_find_group_other(NFS_INO_GROUP(parent_ino));
+    }
+    if (g < 0) {
+        return -NFS_ERROR_NOSPACE;
+    }
+    for (int i = 0; i < nfs_super.inodes_per_group; i++) {
+        if (!nfs_map_test(nfs_super.map_inode, NFS_GROUP_MAP_BIT(g) + i)) {
+            nfs_map_set(nfs_super.map_inode, NFS_GROUP_MAP_BIT(g) + i);
+            nfs_super.groups[g].free_inodes--;
+            nfs_super.free_inodes--;
+            if (is_dir) {
+                nfs_super.groups[g].nr_dirs++;
+            }
+            return g * nfs_super.inodes_per_group + i;
+        }
+    }
+    return -NFS_ERROR_NOSPACE;
+}
+
+/**
+ * @brief 释放inode编号
+ *
+ * @param ino
+ * @param is_dir 是否为目录
+ */
+void nfs_free_inode(int ino, boolean is_dir) {
+    int g = NFS_INO_GROUP(ino);
+    int i = ino % nfs_super.inodes_per_group;
+    if (!nfs_map_test(nfs_super.map_inode, NFS_GROUP_MAP_BIT(g) + i)) {
+        return;
+    }
+    nfs_map_clear(nfs_super.map_inode, NFS_GROUP_MAP_BIT(g) + i);
+    nfs_super.groups[g].free_inodes++;
+    nfs_super.free_inodes++;
+    if (is_dir) {
+        nfs_super.groups[g].nr_dirs--;
+    }
+}
+
+/**
+ * @brief 分配一个数据块，占用数据位图
+ *
+ * 从goal所在块组的goal位置向后找，使同一文件的数据块尽量连续且靠近其inode，
+ * 块组满时顺延到下一个块组
+ *
+ * @param goal 期望的数据块号
+ * @return int 数据块号，空间不足时为-NFS_ERROR_NOSPACE
+ */
+int nfs_new_block(int goal) {
+    int g     = NFS_BLK_GROUP(goal);
+    int start = goal % nfs_super.data_per_group;
+    int i;
+    // 已预留给延迟分配的块不可再分配
+    if (nfs_super.free_blks - nfs_super.resv_blks <= 0) {
+        return -NFS_ERROR_NOSPACE;
+    }
+    for (int cnt = 0; cnt < nfs_super.nr_groups; cnt++) {
+        if (nfs_super.groups[g].free_blks > 0) {
+            for (int k = 0; k < nfs_super.data_per_group; k++) {
+                i = (start + k) % nfs_super.data_per_group;
+                if (!nfs_map_test(nfs_super.map_data, NFS_GROUP_MAP_BIT(g) + i)) {
+                    nfs_map_set(nfs_super.map_data, NFS_GROUP_MAP_BIT(g) + i);
+                    nfs_super.groups[g].free_blks--;
+                    nfs_super.free_blks--;
+                    return g * nfs_super.data_per_group + i;
+                }
+            }
+        }
+        g     = (g + 1) % nfs_super.nr_groups;
+        start = 0;
+    }
+    return -NFS_ERROR_NOSPACE;
+}
+
+// 在块组g中从start向后寻找len个连续空闲块，返回块组内下标，没有则为-1
+static int nfs_group_find_run(int g, int start, int len) {
+    int run = 0;
+    for (int i = start; i < nfs_super.data_per_group; i++) {
+        if (nfs_map_test(nfs_super.map_data, NFS_GROUP_MAP_BIT(g) + i)) {
+            run = 0;
+            continue;
+        }
+        if (++run == len) {
+            return i - len + 1;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 一次分配cnt个数据块，尽量连续
+ *
+ * 依次在goal之后、goal所在块组、其余块组中寻找cnt个连续空闲块，
+ * 均找不到时退化为逐块分配
+ *
+ * @param goal 期望的起始数据块号
+ * @param cnt 块数
+ * @param blknos 返回分配到的数据块号
+ * @return int 0成功，空间不足时为-NFS_ERROR_NOSPACE，且不占用任何块
+ */
+int nfs_new_blocks(int goal, int cnt, int* blknos) {
+    int g = NFS_BLK_GROUP(goal);
+    int i = nfs_group_find_run(g, goal % nfs_super.data_per_group, cnt);
+    if (cnt > nfs_super.free_blks - nfs_super.resv_blks) {
+        return -NFS_ERROR_NOSPACE;
+    }
+    for (int k = 0; i < 0 && k < nfs_super.nr_groups; k++) {
+        g = (NFS_BLK_GROUP(goal) + k) % nfs_super.nr_groups;
+        if (nfs_super.groups[g].free_blks >= cnt) {
+            i = nfs_group_find_run(g, 0, cnt);
+        }
+    }
+    if (i >= 0) {
+        for (int k = 0; k < cnt; k++) {
+            nfs_map_set(nfs_super.map_data, NFS_GROUP_MAP_BIT(g) + i + k);
+            blknos[k] = g * nfs_super.data_per_group + i + k;
+        }
+        nfs_super.groups[g].free_blks -= cnt;
+        nfs_super.free_blks           -= cnt;
+        return NFS_ERROR_NONE;
+    }
+    // 没有足够长的连续空闲区，逐块分配，前一块之后即为下一块的goal
+    for (int k = 0; k < cnt; k++) {
+        blknos[k] = nfs_new_block(k == 0 ? goal : blknos[k - 1] + 1);
+        if (blknos[k] < 0) {
+            while (--k >= 0) {
+                nfs_free_block(blknos[k]);
+            }
+            return -NFS_ERROR_NOSPACE;
+        }
+    }
+    return NFS_ERROR_NONE;
+}
+
+/**
+ * @brief 为延迟分配预留cnt个数据块，保证写回时一定能分配成功
+ *
+ * @param cnt 块数
+ * @return int 0成功，空间不足时为-NFS_ERROR_NOSPACE
+ */
+int nfs_resv_blocks(int cnt) {
+    if (nfs_super.free_blks - nfs_super.resv_blks < cnt) {
+        return -NFS_ERROR_NOSPACE;
+    }
+    nfs_super.resv_blks += cnt;
+    return NFS_ERROR_NONE;
+}
+
+/**
+ * @brief 归还预留的数据块，分配或丢弃延迟数据时调用
+ *
+ * @param cnt 块数
+ */
+void nfs_unresv_blocks(int cnt) {
+    nfs_super.resv_blks -= cnt;
+}
+
+/**
+ * @brief 释放数据块
+ *
+ * @param blkno
+ */
+void nfs_free_block(int blkno) {
+    int g = NFS_BLK_GROUP(blkno);
+    int i = blkno % nfs_super.data_per_group;
+    if (!nfs_map_test(nfs_super.map_data, NFS_GROUP_MAP_BIT(g) + i)) {
+        return;
+    }
+    nfs_map_clear(nfs_super.map_data, NFS_GROUP_MAP_BIT(g) + i);
+    nfs_super.groups[g].free_blks++;
+    nfs_super.free_blks++;
+}
+
+static int nfs_no_cmp(const void* a, const void* b) {
+    return *(const int *)a - *(const int *)b;
+}
+
+// 清除位图中从bit开始的len位，整字节部分直接置零
+static void nfs_map_clear_run(uint8_t* map, int bit, int len) {
+    while (len > 0 && bit % UINT8_BITS != 0) {
+        nfs_map_clear(map, bit++);
+        len--;
+    }
+    memset(map + bit / UINT8_BITS, 0, len / UINT8_BITS);
+    bit += len / UINT8_BITS * UINT8_BITS;
+    len %= UINT8_BITS;
+    while (len-- > 0) {
+        nfs_map_clear(map, bit++);
+    }
+}
+
+/**
+ * @brief 批量释放inode编号，按ino排序后逐个清除位图
+ *
+ * @param inos ino数组，会被排序
+ * @param cnt 个数
+ * @param is_dir 是否均为目录
+ */
+void nfs_free_inodes(int* inos, int cnt, boolean is_dir) {
+    qsort(inos, cnt, sizeof(int), nfs_no_cmp);
+    for (int k = 0; k < cnt; k++) {
+        nfs_free_inode(inos[k], is_dir);
+    }
+}
+
+/**
+ * @brief 批量释放数据块
+ *
+ * 先按块号排序，同一块组内连续的一段块只做一次位图清除与统计更新。
+ * 块号须均已分配且互不相同
+ *
+ * @param blknos 数据块号，会被排序
+ * @param cnt 块数
+ */
+void nfs_free_blocks(int* blknos, int cnt) {
+    int g, start, len;
+    qsort(blknos, cnt, sizeof(int), nfs_no_cmp);
+    for (int k = 0; k < cnt; k += len) {
+        g     = NFS_BLK_GROUP(blknos[k]);
+        start = blknos[k] % nfs_super.data_per_group;
+        len   = 1;
+        while (k + len < cnt && blknos[k + len] == blknos[k] + len &&
+               NFS_BLK_GROUP(blknos[k + len]) == g) {
+            len++;
+        }
+        nfs_map_clear_run(nfs_super.map_data, NFS_GROUP_MAP_BIT(g) + start, len);
+        nfs_super.groups[g].free_blks += len;
+        nfs_super.free_blks           += len;
+    }
+}
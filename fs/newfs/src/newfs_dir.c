@@ -0,0 +1,211 @@
+#include "../include/newfs.h"
+
+extern struct nfs_super      nfs_super;
+
+/**
+ * 目录数据块格式（ext2风格变长记录）
+ *
+ * | ino | rec_len | name_len | ftype | fname ... | 填充 | ino | rec_len | ... |
+ *
+ * 1) 每条记录不跨块，块内最后一条记录的rec_len延伸至块尾
+ * 2) name_len为0表示空闲记录
+ * 3) 删除记录时并入块内前一条记录；若为块内首条记录，则标记为空闲
+ */
+#define NFS_DIR_REC_NEXT(rec)   ((struct nfs_dentry_d *)((uint8_t *)(rec) + (rec)->rec_len))
+#define NFS_DIR_REC_USED(rec)   ((rec)->name_len == 0 ? 0 : NFS_DIR_REC_LEN((rec)->name_len))
+
+// 判断记录是否合法，避免损坏的目录块导致死循环或越界
+static boolean nfs_dir_rec_valid(uint8_t* blk, struct nfs_dentry_d* rec) {
+    int ofs = (uint8_t *)rec - blk;
+    if (rec->rec_len < NFS_DIR_REC_LEN(0) || rec->rec_len % NFS_DIR_REC_ALIGN != 0 ||
+        ofs + rec->rec_len > NFS_BLK_SZ()) {
+        return FALSE;
+    }
+    if (NFS_DIR_REC_USED(rec) > rec->rec_len) {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief 初始化一个空目录块：仅含一条覆盖整块的空闲记录
+ *
+ * @param blk 目录块缓冲区
+ */
+void nfs_dir_init_blk(uint8_t* blk) {
+    struct nfs_dentry_d* rec = (struct nfs_dentry_d *)blk;
+    memset(blk, 0, NFS_BLK_SZ());
+    rec->rec_len  = NFS_BLK_SZ();
+    rec->name_len = 0;
+}
+
+/**
+ * @brief 在目录块中寻找能容纳need字节新记录的位置
+ *
+ * @param blk 目录块缓冲区
+ * @param need 新记录长度
+ * @return struct nfs_dentry_d* 可写入新记录的位置，没有则为NULL
+ */
+static struct nfs_dentry_d* nfs_dir_find_room(uint8_t* blk, int need) {
+    struct nfs_dentry_d* rec = (struct nfs_dentry_d *)blk;
+    struct nfs_dentry_d* new_rec;
+    int used;
+    while ((uint8_t *)rec < blk + NFS_BLK_SZ() && nfs_dir_rec_valid(blk, rec)) {
+        used = NFS_DIR_REC_USED(rec);
+        if (rec->rec_len - used >= need) {
+            // 空闲记录直接复用，否则从当前记录尾部拆分出新记录
+            if (used == 0) {
+                return rec;
+            }
+            new_rec           = (struct nfs_dentry_d *)((uint8_t *)rec + used);
+            new_rec->rec_len  = rec->rec_len - used;
+            new_rec->name_len = 0;
+            rec->rec_len      = used;
+            return new_rec;
+        }
+        rec = NFS_DIR_REC_NEXT(rec);
+    }
+    return NULL;
+}
+
+/**
+ * @brief 判断目录是否还能容纳名为fname的目录项
+ *
+ * @param dir 目录inode
+ * @param fname 文件名
+ * @return boolean
+ */
+boolean nfs_dir_has_room(struct nfs_inode* dir, const char* fname) {
+    struct nfs_dentry_d* rec;
+    int need = NFS_DIR_REC_LEN(strlen(fname));
+    int used;
+    for (int i = 0; i < NFS_DATA_PER_FILE; i++) {
+        uint8_t* blk = dir->block_pointer[i];
+        rec = (struct nfs_dentry_d *)blk;
+        while ((uint8_t *)rec < blk + NFS_BLK_SZ() && nfs_dir_rec_valid(blk, rec)) {
+            used = NFS_DIR_REC_USED(rec);
+            if (rec->rec_len - used >= need) {
+                return TRUE;
+            }
+            rec = NFS_DIR_REC_NEXT(rec);
+        }
+    }
+    return FALSE;
+}
+
+/**
+ * @brief 为dentry在目录块中写入一条记录，只弄脏被修改的块
+ *
+ * @param dir 目录inode
+ * @param dentry 新目录项，ino需已确定
+ * @return int 0成功，否则失败
+ */
+int nfs_dir_add_rec(struct nfs_inode* dir, struct nfs_dentry* dentry) {
+    struct nfs_dentry_d* rec;
+    int name_len = dentry->fname_len;
+    for (int i = 0; i < NFS_DATA_PER_FILE; i++) {
+        rec = nfs_dir_find_room(dir->block_pointer[i], NFS_DIR_REC_LEN(name_len));
+        if (rec != NULL) {
+            rec->ino      = dentry->ino;
+            rec->name_len = name_len;
+            rec->ftype    = dentry->ftype;
+            memcpy(rec->fname, dentry->fname, name_len);
+            dir->block_flag[i] |= NFS_FLAG_BUF_DIRTY;
+            return NFS_ERROR_NONE;
+        }
+    }
+    return -NFS_ERROR_NOSPACE;
+}
+
+/**
+ * @brief 从目录块中原地删除dentry对应的记录，并入前一条记录
+ *
+ * @param dir 目录inode
+ * @param dentry 待删除的目录项
+ * @return int 0成功，否则失败
+ */
+int nfs_dir_del_rec(struct nfs_inode* dir, struct nfs_dentry* dentry) {
+    struct nfs_dentry_d* rec;
+    struct nfs_dentry_d* prev;
+    int name_len = dentry->fname_len;
+    for (int i = 0; i < NFS_DATA_PER_FILE; i++) {
+        uint8_t* blk = dir->block_pointer[i];
+        rec  = (struct nfs_dentry_d *)blk;
+        prev = NULL;
+        while ((uint8_t *)rec < blk + NFS_BLK_SZ() && nfs_dir_rec_valid(blk, rec)) {
+            if (rec->name_len == name_len && rec->ino == dentry->ino &&
+                memcmp(rec->fname, dentry->fname, name_len) == 0) {
+                if (prev != NULL) {
+                    prev->rec_len += rec->rec_len;
+                }
+                else {
+                    rec->name_len = 0;
+                }
+                dir->block_flag[i] |= NFS_FLAG_BUF_DIRTY;
+                return NFS_ERROR_NONE;
+            }
+            prev = rec;
+            rec  = NFS_DIR_REC_NEXT(rec);
+        }
+    }
+    return -NFS_ERROR_NOTFOUND;
+}
+
+/**
+ * @brief 将dentry对应的记录原地改为指向target的inode，文件名不变，只弄脏记录所在的块
+ *
+ * @param dir 目录inode
+ * @param dentry 被覆盖的目录项
+ * @param target 新指向的目录项，取其ino与文件类型
+ * @return int 0成功，否则失败
+ */
+int nfs_dir_set_rec(struct nfs_inode* dir, struct nfs_dentry* dentry, struct nfs_dentry* target) {
+    struct nfs_dentry_d* rec;
+    int name_len = dentry->fname_len;
+    for (int i = 0; i < NFS_DATA_PER_FILE; i++) {
+        uint8_t* blk = dir->block_pointer[i];
+        rec = (struct nfs_dentry_d *)blk;
+        while ((uint8_t *)rec < blk + NFS_BLK_SZ() && nfs_dir_rec_valid(blk, rec)) {
+            if (rec->name_len == name_len && rec->ino == dentry->ino &&
+                memcmp(rec->fname, dentry->fname, name_len) == 0) {
+                rec->ino   = target->ino;
+                rec->ftype = target->ftype;
+                dir->block_flag[i] |= NFS_FLAG_BUF_DIRTY;
+                return NFS_ERROR_NONE;
+            }
+            rec = NFS_DIR_REC_NEXT(rec);
+        }
+    }
+    return -NFS_ERROR_NOTFOUND;
+}
+
+/**
+ * @brief 解析目录块，为每条有效记录建立内存dentry并挂到目录inode下
+ *
+ * @param dir 目录inode，block_pointer中已读入目录块
+ * @return int 解析出的目录项数目，内存不足时为-NFS_ERROR_NOMEM
+ */
+int nfs_dir_load(struct nfs_inode* dir) {
+    struct nfs_dentry_d* rec;
+    struct nfs_dentry*   sub_dentry;
+    char                 fname[NFS_MAX_FILE_NAME];
+    for (int i = 0; i < NFS_DATA_PER_FILE; i++) {
+        uint8_t* blk = dir->block_pointer[i];
+        rec = (struct nfs_dentry_d *)blk;
+        while ((uint8_t *)rec < blk + NFS_BLK_SZ() && nfs_dir_rec_valid(blk, rec)) {
+            if (rec->name_len != 0 && rec->name_len < NFS_MAX_FILE_NAME) {
+                memcpy(fname, rec->fname, rec->name_len);
+                fname[rec->name_len] = '\0';
+                sub_dentry = new_dentry(fname, rec->ftype);
+                if (sub_dentry == NULL) {
+                    return -NFS_ERROR_NOMEM;
+                }
+                sub_dentry->parent = dir->dentry;
+                sub_dentry->ino    = rec->ino;
+                nfs_alloc_dentry(dir, sub_dentry);
+            }
+            rec = NFS_DIR_REC_NEXT(rec);
+        }
+    }
+    return dir->dir_cnt;
+}
@@ -0,0 +1,551 @@
+#include "../include/newfs.h"
+
+extern struct nfs_super      nfs_super;
+
+/**
+ * 元数据日志（块级重做日志）
+ *
+ * 日志区格式：
+ * | Header | Desc | Blk ... Blk | Commit | Desc | Blk ... Blk | Commit | ... |
+ *
+ * 1) Header记录日志区第1块处应出现的事务序号，检查点后序号前移，旧记录随之失效
+ * 2) 每个事务由描述块、各元数据块的完整镜像与提交块组成，提交块含校验和
+ * 3) 元数据操作在nfs_jnl_begin/nfs_jnl_end之间把修改过的块镜像加入运行事务，
+ *    多个操作共享同一运行事务（复合事务），累积到一定块数或超过提交间隔才写一次日志
+ * 4) 已提交的块先不写回原位置，日志区将满或卸载时统一检查点
+ * 5) 挂载时按序号重放所有完整且校验正确的事务
+ */
+
+// 累计校验和（FNV-1a）
+static uint32_t nfs_jnl_csum(uint32_t csum, const uint8_t* buf, int len) {
+    for (int i = 0; i < len; i++) {
+        csum ^= buf[i];
+        csum *= 16777619u;
+    }
+    return csum;
+}
+
+// 写日志头，使日志区第1块处只接受序号为seq的事务
+static int nfs_jnl_write_hdr(uint32_t seq) {
+    struct nfs_jnl_hdr_d jnl_hdr_d;
+    jnl_hdr_d.magic = NFS_JNL_HDR_MAGIC;
+    jnl_hdr_d.seq   = seq;
+    return nfs_driver_write(NFS_JNL_OFS(0), (uint8_t *)&jnl_hdr_d, sizeof(struct nfs_jnl_hdr_d));
+}
+
+/**
+ * @brief 检查点：将所有已提交块的镜像写回原位置，并清空日志区
+ *
+ * @param jnl
+ * @param seq 之后写入日志区第1块的事务序号
+ * @return int 0成功，否则失败
+ */
+static int nfs_jnl_do_checkpoint(struct nfs_journal* jnl, uint32_t seq) {
+    for (int i = 0; i < jnl->nr_ckpt; i++) {
+        if (nfs_driver_write(NFS_BLKS_SZ(jnl->ckpt_blknos[i]), jnl->ckpt_imgs[i],
+                             NFS_BLK_SZ()) != NFS_ERROR_NONE) {
+            NFS_DBG("[%s] io error\n", __func__);
+            return -NFS_ERROR_IO;
+        }
+        free(jnl->ckpt_imgs[i]);
+        jnl->ckpt_imgs[i] = NULL;
+    }
+    jnl->nr_ckpt = 0;
+    jnl->head    = 1;
+    return nfs_jnl_write_hdr(seq);
+}
+
+// 将已提交事务的镜像并入检查点列表，同一块只保留最新镜像
+static void nfs_jnl_add_ckpt(struct nfs_journal* jnl, struct nfs_jnl_txn* txn) {
+    int i, j;
+    for (i = 0; i < txn->nr_blks; i++) {
+        for (j = 0; j < jnl->nr_ckpt; j++) {
+            if (jnl->ckpt_blknos[j] == txn->blknos[i]) {
+                break;
+            }
+        }
+        if (j < jnl->nr_ckpt) {
+            free(jnl->ckpt_imgs[j]);
+        }
+        else {
+            jnl->ckpt_blknos[jnl->nr_ckpt++] = txn->blknos[i];
+        }
+        jnl->ckpt_imgs[j] = txn->imgs[i];
+        txn->imgs[i]      = NULL;
+    }
+}
+
+// 将事务的描述块、镜像与提交块写入日志区，只由提交者调用
+static int nfs_jnl_write_txn(struct nfs_journal* jnl, struct nfs_jnl_txn* txn) {
+    struct nfs_jnl_desc_d*   jnl_desc_d;
+    struct nfs_jnl_commit_d* jnl_commit_d;
+    uint32_t                 csum;
+    int                      ret;
+
+    // 日志区剩余空间不足，先检查点
+    if (jnl->head + txn->nr_blks + 2 > nfs_super.journal_blks) {
+        ret = nfs_jnl_do_checkpoint(jnl, txn->seq);
+        if (ret != NFS_ERROR_NONE) {
+            return ret;
+        }
+    }
+    // 描述块与各镜像依次写在日志区的连续块上，驱动位置连续，不再拼成一个大缓冲区
+    jnl_desc_d          = (struct nfs_jnl_desc_d *)jnl->desc_buf;
+    memset(jnl->desc_buf, 0, NFS_BLK_SZ());
+    jnl_desc_d->magic   = NFS_JNL_DESC_MAGIC;
+    jnl_desc_d->seq     = txn->seq;
+    jnl_desc_d->nr_blks = txn->nr_blks;
+    for (int i = 0; i < txn->nr_blks; i++) {
+        jnl_desc_d->blknos[i] = txn->blknos[i];
+    }
+    csum = nfs_jnl_csum(2166136261u, jnl->desc_buf, NFS_BLK_SZ());
+    if (nfs_driver_write(NFS_JNL_OFS(jnl->head), jnl->desc_buf, NFS_BLK_SZ()) != NFS_ERROR_NONE) {
+        return -NFS_ERROR_IO;
+    }
+    for (int i = 0; i < txn->nr_blks; i++) {
+        csum = nfs_jnl_csum(csum, txn->imgs[i], NFS_BLK_SZ());
+        if (nfs_driver_write(NFS_JNL_OFS(jnl->head + i + 1), txn->imgs[i],
+                             NFS_BLK_SZ()) != NFS_ERROR_NONE) {
+            return -NFS_ERROR_IO;
+        }
+    }
+    // 镜像落盘后再写提交块，提交块写完事务才算提交；整块写出，免去读-改-写
+    jnl_commit_d        = (struct nfs_jnl_commit_d *)jnl->desc_buf;
+    memset(jnl->desc_buf, 0, NFS_BLK_SZ());
+    jnl_commit_d->magic = NFS_JNL_COMMIT_MAGIC;
+    jnl_commit_d->seq   = txn->seq;
+    jnl_commit_d->csum  = csum;
+    if (nfs_driver_write(NFS_JNL_OFS(jnl->head + txn->nr_blks + 1), jnl->desc_buf,
+                         NFS_BLK_SZ()) != NFS_ERROR_NONE) {
+        return -NFS_ERROR_IO;
+    }
+    jnl->head += txn->nr_blks + 2;
+    nfs_jnl_add_ckpt(jnl, txn);
+    return NFS_ERROR_NONE;
+}
+
+/**
+ * @brief 提交运行事务，需持有jnl->lock
+ *
+ * 同一时刻只有一个提交者。运行事务被移出后立即开启新的运行事务，
+ * 写日志期间释放lock，其他操作与fsync可继续加入新的运行事务，
+ * 下一次提交时一并写入，从而把并发的fsync合并为一次日志写。
+ * 提交块写完后刷写设备一次，组提交的所有fsync共用这一次刷写。
+ * 提交失败后日志中止：丢失的事务之后的事务可能依赖它，不能再提交，
+ * 运行事务被丢弃，之后的提交与等待都返回该错误
+ *
+ * @param jnl
+ * @return int 0成功，否则失败
+ */
+static int nfs_jnl_commit_txn(struct nfs_journal* jnl) {
+    int ret;
+    while (jnl->committing) {
+        pthread_cond_wait(&jnl->commit_cond, &jnl->lock);
+    }
+    if (jnl->aborted != NFS_ERROR_NONE) {
+        for (int i = 0; i < jnl->running.nr_blks; i++) {
+            free(jnl->running.imgs[i]);
+        }
+        jnl->running.nr_blks = 0;
+        return jnl->aborted;
+    }
+    if (jnl->running.nr_blks == 0) {
+        return NFS_ERROR_NONE;
+    }
+    jnl->commit              = jnl->running;
+    jnl->running.seq         = jnl->commit.seq + 1;
+    jnl->running.nr_blks     = 0;
+    jnl->committing          = TRUE;
+    pthread_mutex_unlock(&jnl->lock);
+
+    ret = nfs_jnl_write_txn(jnl, &jnl->commit);
+    if (ret == NFS_ERROR_NONE &&
+        ddriver_ioctl(NFS_DRIVER(), IOC_REQ_DEVICE_FLUSH, NULL) != 0) {
+        ret = -NFS_ERROR_IO;
+    }
+
+    pthread_mutex_lock(&jnl->lock);
+    for (int i = 0; i < jnl->commit.nr_blks; i++) {
+        free(jnl->commit.imgs[i]);     // 写失败时镜像未移入检查点列表
+    }
+    jnl->commit.nr_blks = 0;
+    if (ret == NFS_ERROR_NONE) {
+        jnl->commit_seq = jnl->commit.seq;
+    }
+    else {
+        jnl->aborted = ret;
+    }
+    jnl->committing = FALSE;
+    pthread_cond_broadcast(&jnl->commit_cond);
+    return ret;
+}
+
+// 后台提交线程，每隔NFS_JNL_COMMIT_INTERVAL秒提交一次运行事务
+static void* nfs_jnl_committer(void* arg) {
+    struct nfs_journal* jnl = (struct nfs_journal *)arg;
+    struct timespec     ts;
+    pthread_mutex_lock(&jnl->lock);
+    while (!jnl->stopping) {
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += NFS_JNL_COMMIT_INTERVAL;
+        pthread_cond_timedwait(&jnl->cond, &jnl->lock, &ts);
+        if (nfs_jnl_commit_txn(jnl) != NFS_ERROR_NONE) {
+            NFS_DBG("[%s] commit error\n", __func__);
+        }
+    }
+    pthread_mutex_unlock(&jnl->lock);
+    return NULL;
+}
+
+/**
+ * @brief 重放日志，挂载时在读取位图与inode之前调用
+ *
+ * @param journal_offset 日志区磁盘偏移
+ * @param journal_blks 日志区块数
+ * @param next_seq 返回下一个事务应使用的序号
+ * @return int 重放的事务数，出错时为负
+ */
+int nfs_jnl_replay(int journal_offset, int journal_blks, uint32_t* next_seq) {
+    struct nfs_jnl_hdr_d     jnl_hdr_d;
+    struct nfs_jnl_desc_d*   jnl_desc_d;
+    struct nfs_jnl_commit_d  jnl_commit_d;
+    uint8_t*                 buf;
+    uint32_t                 seq;
+    int                      pos = 1;
+    int                      cnt = 0;
+
+    if (nfs_driver_read(journal_offset, (uint8_t *)&jnl_hdr_d,
+                        sizeof(struct nfs_jnl_hdr_d)) != NFS_ERROR_NONE) {
+        return -NFS_ERROR_IO;
+    }
+    if (jnl_hdr_d.magic != NFS_JNL_HDR_MAGIC) {
+        *next_seq = 1;
+        return 0;
+    }
+    seq = jnl_hdr_d.seq;
+    buf = (uint8_t *)malloc(NFS_BLKS_SZ(NFS_JNL_TXN_MAX + 1));
+    jnl_desc_d = (struct nfs_jnl_desc_d *)buf;
+    while (pos + 2 <= journal_blks) {
+        // 描述块必须是期望的下一个事务
+        if (nfs_driver_read(journal_offset + NFS_BLKS_SZ(pos), buf, NFS_BLK_SZ()) != NFS_ERROR_NONE) {
+            break;
+        }
+        if (jnl_desc_d->magic != NFS_JNL_DESC_MAGIC || jnl_desc_d->seq != seq ||
+            jnl_desc_d->nr_blks <= 0 || jnl_desc_d->nr_blks > NFS_JNL_TXN_MAX ||
+            pos + jnl_desc_d->nr_blks + 2 > journal_blks) {
+            break;
+        }
+        // 提交块存在且校验和一致，事务才完整
+        if (nfs_driver_read(journal_offset + NFS_BLKS_SZ(pos + 1), buf + NFS_BLK_SZ(),
+                            NFS_BLKS_SZ(jnl_desc_d->nr_blks)) != NFS_ERROR_NONE ||
+            nfs_driver_read(journal_offset + NFS_BLKS_SZ(pos + jnl_desc_d->nr_blks + 1),
+                            (uint8_t *)&jnl_commit_d, sizeof(struct nfs_jnl_commit_d)) != NFS_ERROR_NONE) {
+            break;
+        }
+        if (jnl_commit_d.magic != NFS_JNL_COMMIT_MAGIC || jnl_commit_d.seq != seq ||
+            jnl_commit_d.csum != nfs_jnl_csum(2166136261u, buf, NFS_BLKS_SZ(jnl_desc_d->nr_blks + 1))) {
+            break;
+        }
+        for (int i = 0; i < jnl_desc_d->nr_blks; i++) {
+            if (nfs_driver_write(NFS_BLKS_SZ(jnl_desc_d->blknos[i]), buf + NFS_BLKS_SZ(i + 1),
+                                 NFS_BLK_SZ()) != NFS_ERROR_NONE) {
+                free(buf);
+                return -NFS_ERROR_IO;
+            }
+        }
+        pos += jnl_desc_d->nr_blks + 2;
+        seq++;
+        cnt++;
+    }
+    free(buf);
+    // 已全部写回原位置，前移序号使日志区清空
+    jnl_hdr_d.seq = seq;
+    if (nfs_driver_write(journal_offset, (uint8_t *)&jnl_hdr_d,
+                         sizeof(struct nfs_jnl_hdr_d)) != NFS_ERROR_NONE) {
+        return -NFS_ERROR_IO;
+    }
+    *next_seq = seq;
+    return cnt;
+}
+
+/**
+ * @brief 初始化日志并启动后台提交线程，挂载时在日志重放之后调用
+ *
+ * @param seq 下一个事务的序号
+ * @param is_init 磁盘是否刚格式化，是则写入日志头
+ * @return int 0成功，否则失败
+ */
+int nfs_jnl_init(uint32_t seq, boolean is_init) {
+    struct nfs_journal* jnl = &nfs_super.journal;
+    pthread_mutex_init(&jnl->lock, NULL);
+    pthread_cond_init(&jnl->cond, NULL);
+    pthread_cond_init(&jnl->commit_cond, NULL);
+    jnl->stopping         = FALSE;
+    jnl->committing       = FALSE;
+    jnl->commit.nr_blks   = 0;
+    jnl->running.seq      = seq;
+    jnl->running.nr_blks  = 0;
+    jnl->commit_seq       = seq - 1;
+    jnl->aborted          = NFS_ERROR_NONE;
+    jnl->head             = 1;
+    jnl->nr_ckpt          = 0;
+    jnl->desc_buf         = (uint8_t *)malloc(NFS_BLK_SZ());
+    if (jnl->desc_buf == NULL) {
+        return -NFS_ERROR_NOMEM;
+    }
+    if (is_init && nfs_jnl_write_hdr(seq) != NFS_ERROR_NONE) {
+        return -NFS_ERROR_IO;
+    }
+    if (pthread_create(&jnl->committer, NULL, nfs_jnl_committer, jnl) != 0) {
+        return -NFS_ERROR_INVAL;
+    }
+    return NFS_ERROR_NONE;
+}
+
+/**
+ * @brief 开始一个元数据操作，加入运行事务
+ *
+ * 运行事务剩余空间不足以容纳一个操作时先提交
+ */
+void nfs_jnl_begin() {
+    struct nfs_journal* jnl = &nfs_super.journal;
+    pthread_mutex_lock(&jnl->lock);
+    if (jnl->running.nr_blks + NFS_JNL_OP_MAX_BLKS > NFS_JNL_TXN_MAX) {
+        nfs_jnl_commit_txn(jnl);
+    }
+}
+
+/**
+ * @brief 结束一个元数据操作，运行事务累积足够多的块时立即提交
+ *
+ * @return int 0成功，否则失败
+ */
+int nfs_jnl_end() {
+    struct nfs_journal* jnl = &nfs_super.journal;
+    int ret = NFS_ERROR_NONE;
+    if (jnl->running.nr_blks >= NFS_JNL_BATCH_BLKS) {
+        ret = nfs_jnl_commit_txn(jnl);
+    }
+    pthread_mutex_unlock(&jnl->lock);
+    return ret;
+}
+
+// 取运行事务中blkno的镜像，同一事务内重复修改的块只保留一份镜像
+static uint8_t* nfs_jnl_img(int blkno) {
+    struct nfs_jnl_txn* txn = &nfs_super.journal.running;
+    int i;
+    for (i = 0; i < txn->nr_blks; i++) {
+        if (txn->blknos[i] == blkno) {
+            return txn->imgs[i];
+        }
+    }
+    txn->blknos[i] = blkno;
+    txn->imgs[i]   = (uint8_t *)malloc(NFS_BLK_SZ());
+    txn->nr_blks++;
+    return txn->imgs[i];
+}
+
+/**
+ * @brief 记录一个被修改的元数据块，复制其当前内容为镜像
+ *
+ * @param blkno 块号
+ * @param buf 块内容
+ */
+void nfs_jnl_dirty_blk(int blkno, const uint8_t* buf) {
+    memcpy(nfs_jnl_img(blkno), buf, NFS_BLK_SZ());
+}
+
+/**
+ * @brief 返回运行事务的序号，等待该序号提交即可保证此前记录的修改落盘
+ *
+ * @return uint32_t
+ */
+uint32_t nfs_jnl_running_seq() {
+    return nfs_super.journal.running.seq;
+}
+
+/**
+ * @brief 记录inode块，目录还会记录其中被修改的目录块
+ *
+ * @param inode
+ */
+void nfs_jnl_dirty_inode(struct nfs_inode* inode) {
+    // 直接打包进镜像，不经临时缓冲区
+    uint8_t* img = nfs_jnl_img(NFS_BLKNO(NFS_INO_OFS(inode->ino)));
+    memset(img, 0, NFS_BLK_SZ());
+    nfs_pack_inode(inode, (struct nfs_inode_d *)img);
+    inode->jnl_seq = nfs_super.journal.running.seq;
+    inode->dirty   = FALSE;
+    // 目录块由日志负责写回，清除脏标记
+    if (NFS_IS_DIR(inode)) {
+        for (int i = 0; i < NFS_DATA_PER_FILE; i++) {
+            if (inode->block_flag[i] & NFS_FLAG_BUF_DIRTY) {
+                nfs_jnl_dirty_blk(NFS_BLKNO(NFS_DATA_OFS(inode->blockno[i])), inode->block_pointer[i]);
+                inode->block_flag[i] &= ~NFS_FLAG_BUF_DIRTY;
+            }
+        }
+    }
+}
+
+/**
+ * @brief 记录第ino个inode所在的inode位图块
+ *
+ * @param ino
+ */
+void nfs_jnl_dirty_map_inode(int ino) {
+    int blk = NFS_INO_GROUP(ino);           // 每个块组的inode位图占一块
+    nfs_jnl_dirty_blk(NFS_BLKNO(nfs_super.map_inode_offset) + blk,
+                      nfs_super.map_inode + NFS_BLKS_SZ(blk));
+}
+
+/**
+ * @brief 记录第blkno个数据块所在的数据位图块
+ *
+ * @param blkno
+ */
+void nfs_jnl_dirty_map_data(int blkno) {
+    int blk = NFS_BLK_GROUP(blkno);         // 每个块组的数据位图占一块
+    nfs_jnl_dirty_blk(NFS_BLKNO(nfs_super.map_data_offset) + blk,
+                      nfs_super.map_data + NFS_BLKS_SZ(blk));
+}
+
+/**
+ * @brief 记录超级块，分配或释放inode、数据块后调用，使空闲统计与位图一同提交
+ */
+void nfs_jnl_dirty_super() {
+    uint8_t* img = nfs_jnl_img(NFS_BLKNO(NFS_SUPER_OFS));
+    memset(img, 0, NFS_BLK_SZ());
+    nfs_pack_super((struct nfs_super_d *)img);
+}
+
+/**
+ * @brief 立即提交运行事务
+ *
+ * @return int 0成功，否则失败
+ */
+int nfs_jnl_commit() {
+    struct nfs_journal* jnl = &nfs_super.journal;
+    int ret;
+    pthread_mutex_lock(&jnl->lock);
+    ret = nfs_jnl_commit_txn(jnl);
+    pthread_mutex_unlock(&jnl->lock);
+    return ret;
+}
+
+/**
+ * @brief 等待序号为seq的事务提交，不持有jnl->lock时调用
+ *
+ * 若seq仍是运行事务，调用者自己成为提交者；若已有提交进行中，
+ * 则等待其完成，期间加入的其他fsync在下一次提交中一并落盘
+ *
+ * @param seq 事务序号
+ * @return int 0成功，事务提交失败时为-NFS_ERROR_IO
+ */
+int nfs_jnl_wait(uint32_t seq) {
+    struct nfs_journal* jnl = &nfs_super.journal;
+    int ret = NFS_ERROR_NONE;
+    pthread_mutex_lock(&jnl->lock);
+    while ((int32_t)(jnl->commit_seq - seq) < 0) {
+        if (jnl->aborted != NFS_ERROR_NONE) {
+            ret = -NFS_ERROR_IO;        // 该事务随失败的提交丢失，或因日志中止无法提交
+            break;
+        }
+        if (jnl->committing) {
+            pthread_cond_wait(&jnl->commit_cond, &jnl->lock);
+        }
+        else if (jnl->running.seq == seq && jnl->running.nr_blks > 0) {
+            ret = nfs_jnl_commit_txn(jnl);
+            if (ret != NFS_ERROR_NONE) {
+                ret = -NFS_ERROR_IO;
+                break;
+            }
+        }
+        else if (jnl->running.seq == seq && jnl->running.nr_blks == 0) {
+            break;      // 该事务为空，无需提交
+        }
+        else {
+            ret = -NFS_ERROR_IO;        // 不在运行也未提交，只能是提交失败
+            break;
+        }
+    }
+    pthread_mutex_unlock(&jnl->lock);
+    return ret;
+}
+
+/**
+ * @brief 等待序号为seq的事务随后台线程定时提交，自己不发起提交，不持有jnl->lock时调用
+ *
+ * @param seq 事务序号
+ * @return int 0成功，事务提交失败时为-NFS_ERROR_IO
+ */
+int nfs_jnl_wait_commit(uint32_t seq) {
+    struct nfs_journal* jnl = &nfs_super.journal;
+    int ret = NFS_ERROR_NONE;
+    pthread_mutex_lock(&jnl->lock);
+    while ((int32_t)(jnl->commit_seq - seq) < 0) {
+        if (jnl->aborted != NFS_ERROR_NONE) {
+            ret = -NFS_ERROR_IO;
+            break;
+        }
+        if (!jnl->committing && jnl->running.seq == seq && jnl->running.nr_blks == 0) {
+            break;      // 该事务为空，无需提交
+        }
+        pthread_cond_wait(&jnl->commit_cond, &jnl->lock);
+    }
+    pthread_mutex_unlock(&jnl->lock);
+    return ret;
+}
+
+/**
+ * @brief 提交运行事务并检查点，清空日志区，不持有jnl->lock时调用
+ *
+ * 释放目录块前调用：此后日志区中不再有其旧镜像，块被重新分配后崩溃重放不会覆盖新内容
+ *
+ * @return int 0成功，否则失败
+ */
+int nfs_jnl_checkpoint() {
+    struct nfs_journal* jnl = &nfs_super.journal;
+    int ret;
+    pthread_mutex_lock(&jnl->lock);
+    ret = nfs_jnl_commit_txn(jnl);
+    if (ret == NFS_ERROR_NONE) {
+        ret = nfs_jnl_do_checkpoint(jnl, jnl->running.seq);
+    }
+    pthread_mutex_unlock(&jnl->lock);
+    return ret;
+}
+
+/**
+ * @brief 停止提交线程，提交运行事务并检查点，卸载时调用
+ *
+ * @return int 0成功，否则失败
+ */
+int nfs_jnl_destroy() {
+    struct nfs_journal* jnl = &nfs_super.journal;
+    int ret;
+    pthread_mutex_lock(&jnl->lock);
+    jnl->stopping = TRUE;
+    pthread_cond_signal(&jnl->cond);
+    pthread_mutex_unlock(&jnl->lock);
+    pthread_join(jnl->committer, NULL);
+
+    pthread_mutex_lock(&jnl->lock);
+    ret = nfs_jnl_commit_txn(jnl);
+    pthread_mutex_unlock(&jnl->lock);
+    if (ret == NFS_ERROR_NONE) {
+        ret = nfs_jnl_do_checkpoint(jnl, jnl->running.seq);
+    }
+    for (int i = 0; i < jnl->running.nr_blks; i++) {
+        free(jnl->running.imgs[i]);
+    }
+    for (int i = 0; i < jnl->nr_ckpt; i++) {
+        free(jnl->ckpt_imgs[i]);
+    }
+    jnl->running.nr_blks = 0;
+    jnl->nr_ckpt         = 0;
+    free(jnl->desc_buf);
+    pthread_cond_destroy(&jnl->cond);
+    pthread_cond_destroy(&jnl->commit_cond);
+    pthread_mutex_destroy(&jnl->lock);
+    return ret;
+}
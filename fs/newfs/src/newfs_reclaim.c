@@ -0,0 +1,235 @@
+#include "../include/newfs.h"
+
+extern struct nfs_super      nfs_super;
+
+/**
+ * 孤儿inode的后台回收
+ *
+ * 1) unlink/rmdir只从父目录中摘除目录项，并把inode挂到孤儿链表头，
+ *    与父目录块在同一操作中记录日志，释放inode与数据块交给回收线程
+ * 2) 孤儿链表持久化：超级块记录链表头ino，inode_d.next_orphan链接后继，
+ *    崩溃后挂载时按链表继续回收，不会泄漏inode与数据块
+ * 3) 回收线程每次取走整条链表作为一批，待摘除它们的事务提交后，
+ *    递归收集整棵子树的ino与数据块，排序后按块组、按连续段批量清除位图
+ * 4) 目录块的镜像可能仍在日志区中，一批中含有目录时先检查点，
+ *    避免目录块被重新分配为文件数据后，崩溃重放用旧镜像覆盖新数据
+ */
+
+// 向数组追加一个元素，容量不足时翻倍
+static void nfs_batch_push(int** arr, int* nr, int* cap, int val) {
+    if (*nr == *cap) {
+        *cap = *cap == 0 ? 64 : *cap * 2;
+        *arr = (int *)realloc(*arr, *cap * sizeof(int));
+    }
+    (*arr)[(*nr)++] = val;
+}
+
+/**
+ * @brief 将待释放的ino记入batch
+ *
+ * @param batch
+ * @param ino
+ * @param is_dir 是否为目录
+ */
+void nfs_batch_add_ino(struct nfs_free_batch* batch, int ino, boolean is_dir) {
+    if (is_dir) {
+        nfs_batch_push(&batch->dir_inos, &batch->nr_dir_inos, &batch->cap_dir_inos, ino);
+    }
+    else {
+        nfs_batch_push(&batch->inos, &batch->nr_inos, &batch->cap_inos, ino);
+    }
+}
+
+/**
+ * @brief 将待释放的数据块记入batch
+ *
+ * @param batch
+ * @param blkno
+ */
+void nfs_batch_add_blk(struct nfs_free_batch* batch, int blkno) {
+    nfs_batch_push(&batch->blknos, &batch->nr_blks, &batch->cap_blks, blkno);
+}
+
+// 记录排好序的ino所在的各inode位图块，同一块组只记录一次
+static void nfs_batch_dirty_map_inode(int* inos, int cnt) {
+    for (int k = 0; k < cnt; k++) {
+        if (k == 0 || NFS_INO_GROUP(inos[k]) != NFS_INO_GROUP(inos[k - 1])) {
+            nfs_jnl_dirty_map_inode(inos[k]);
+        }
+    }
+}
+
+/**
+ * @brief 回收一批孤儿inode
+ *
+ * @return int 0成功，否则失败
+ */
+static int nfs_reclaim_run() {
+    struct nfs_reclaim*   rcl = &nfs_super.reclaim;
+    struct nfs_free_batch batch;
+    struct nfs_inode*     list;
+    struct nfs_inode*     inode;
+    struct nfs_inode*     next;
+    struct nfs_dentry*    dentry;
+    boolean               has_dir = FALSE;
+    uint32_t              seq;
+    int                   ret;
+
+    // 取走当前整条孤儿链表，之后新加入的孤儿留到下一批
+    nfs_jnl_begin();
+    list = rcl->orphans;
+    seq  = nfs_jnl_running_seq();
+    for (inode = list; inode != NULL; inode = inode->orphan_next) {
+        if (NFS_IS_DIR(inode)) {
+            has_dir = TRUE;
+        }
+    }
+    nfs_jnl_end();
+    if (list == NULL) {
+        return NFS_ERROR_NONE;
+    }
+
+    // 摘除目录项的事务提交后才能释放，卸载时立即提交，否则随后台定时提交
+    if (rcl->stopping) {
+        ret = nfs_jnl_wait(seq);
+    }
+    else {
+        ret = nfs_jnl_wait_commit(seq);
+    }
+    if (ret == NFS_ERROR_NONE && has_dir) {
+        ret = nfs_jnl_checkpoint();
+    }
+    if (ret != NFS_ERROR_NONE) {
+        return ret;
+    }
+
+    nfs_jnl_begin();
+    // 从孤儿链表上截下本批
+    if (rcl->orphans == list) {
+        rcl->orphans = NULL;
+    }
+    else {
+        for (inode = rcl->orphans; inode->orphan_next != list; inode = inode->orphan_next);
+        inode->orphan_next = NULL;
+        nfs_jnl_dirty_inode(inode);
+    }
+    // 收集整棵子树的ino与数据块，释放内存结构
+    memset(&batch, 0, sizeof(struct nfs_free_batch));
+    for (inode = list; inode != NULL; inode = next) {
+        next   = inode->orphan_next;
+        dentry = inode->dentry;
+        nfs_drop_inode(inode, &batch);
+        free_dentry(dentry);
+    }
+    // 排序后批量清除位图，每个位图块与超级块各记录一次
+    nfs_free_inodes(batch.inos, batch.nr_inos, FALSE);
+    nfs_free_inodes(batch.dir_inos, batch.nr_dir_inos, TRUE);
+    nfs_free_blocks(batch.blknos, batch.nr_blks);
+    nfs_batch_dirty_map_inode(batch.inos, batch.nr_inos);
+    nfs_batch_dirty_map_inode(batch.dir_inos, batch.nr_dir_inos);
+    for (int k = 0; k < batch.nr_blks; k++) {
+        if (k == 0 || NFS_BLK_GROUP(batch.blknos[k]) != NFS_BLK_GROUP(batch.blknos[k - 1])) {
+            nfs_jnl_dirty_map_data(batch.blknos[k]);
+        }
+    }
+    nfs_jnl_dirty_super();
+    ret = nfs_jnl_end();
+
+    free(batch.inos);
+    free(batch.dir_inos);
+    free(batch.blknos);
+    return ret;
+}
+
+// 后台回收线程，有孤儿时被唤醒；卸载时处理完剩余孤儿后退出
+static void* nfs_reclaimer(void* arg) {
+    struct nfs_reclaim* rcl = (struct nfs_reclaim *)arg;
+    struct nfs_journal* jnl = &nfs_super.journal;
+    pthread_mutex_lock(&jnl->lock);
+    while (TRUE) {
+        while (rcl->orphans == NULL && !rcl->stopping) {
+            pthread_cond_wait(&rcl->cond, &jnl->lock);
+        }
+        if (rcl->orphans == NULL) {
+            break;
+        }
+        pthread_mutex_unlock(&jnl->lock);
+        if (nfs_reclaim_run() != NFS_ERROR_NONE) {
+            // 出错时孤儿仍留在磁盘链表中，下次挂载时继续回收
+            NFS_DBG("[%s] reclaim error\n", __func__);
+            pthread_mutex_lock(&jnl->lock);
+            break;
+        }
+        pthread_mutex_lock(&jnl->lock);
+    }
+    pthread_mutex_unlock(&jnl->lock);
+    return NULL;
+}
+
+/**
+ * @brief 读入磁盘上的孤儿链表并启动回收线程，挂载时在日志初始化之后调用
+ *
+ * @param orphan_head 超级块中记录的孤儿链表首个ino，-1表示为空
+ * @return int 0成功，否则失败
+ */
+int nfs_reclaim_init(int orphan_head) {
+    struct nfs_reclaim* rcl  = &nfs_super.reclaim;
+    struct nfs_inode**  tail = &rcl->orphans;
+    struct nfs_inode_d  inode_d;
+    struct nfs_dentry*  dentry;
+    int                 ino  = orphan_head;
+    rcl->orphans  = NULL;
+    rcl->stopping = FALSE;
+    while (ino >= 0 && ino < nfs_super.max_ino) {
+        if (nfs_driver_read(NFS_INO_OFS(ino), (uint8_t *)&inode_d,
+                            sizeof(struct nfs_inode_d)) != NFS_ERROR_NONE) {
+            return -NFS_ERROR_IO;
+        }
+        // 孤儿已没有文件名，用匿名dentry承载其文件类型
+        dentry        = new_dentry("", inode_d.ftype);
+        if (dentry == NULL) {
+            return -NFS_ERROR_NOMEM;
+        }
+        dentry->ino   = ino;
+        dentry->inode = nfs_read_inode(dentry, ino);
+        if (dentry->inode == NULL) {
+            return -NFS_ERROR_IO;
+        }
+        *tail = dentry->inode;
+        tail  = &dentry->inode->orphan_next;
+        ino   = inode_d.next_orphan;
+    }
+    pthread_cond_init(&rcl->cond, NULL);
+    if (pthread_create(&rcl->reclaimer, NULL, nfs_reclaimer, rcl) != 0) {
+        return -NFS_ERROR_INVAL;
+    }
+    return NFS_ERROR_NONE;
+}
+
+/**
+ * @brief 将已摘除目录项的inode加入孤儿链表，唤醒回收线程，调用者需处于元数据操作中
+ *
+ * @param inode
+ */
+void nfs_reclaim_add(struct nfs_inode* inode) {
+    struct nfs_reclaim* rcl = &nfs_super.reclaim;
+    inode->orphan_next = rcl->orphans;
+    rcl->orphans       = inode;
+    nfs_jnl_dirty_inode(inode);
+    nfs_jnl_dirty_super();
+    pthread_cond_signal(&rcl->cond);
+}
+
+/**
+ * @brief 回收剩余孤儿并停止回收线程，卸载时在停止日志之前调用
+ */
+void nfs_reclaim_destroy() {
+    struct nfs_reclaim* rcl = &nfs_super.reclaim;
+    struct nfs_journal* jnl = &nfs_super.journal;
+    pthread_mutex_lock(&jnl->lock);
+    rcl->stopping = TRUE;
+    pthread_cond_signal(&rcl->cond);
+    pthread_mutex_unlock(&jnl->lock);
+    pthread_join(rcl->reclaimer, NULL);
+    pthread_cond_destroy(&rcl->cond);
+}
@@ -0,0 +1,369 @@
+#include "../include/newfs.h"
+
+extern struct nfs_super      nfs_super;
+
+/**
+ * @brief 初始化一个slab缓存
+ *
+ * 对象大小向上取整到缓存行，保证每个对象都从缓存行边界开始，
+ * 同一缓存行内不会混入两个对象
+ *
+ * @param slab 待初始化的slab
+ * @param obj_sz 对象大小
+ */
+void nfs_slab_init(struct nfs_slab* slab, int obj_sz) {
+    slab->obj_sz         = NFS_ROUND_UP(obj_sz, NFS_CACHELINE_SZ);
+    slab->objs_per_chunk = NFS_SLAB_CHUNK_SZ / slab->obj_sz;
+    if (slab->objs_per_chunk == 0) {
+        slab->objs_per_chunk = 1;
+    }
+    slab->free_list = NULL;
+    slab->chunks    = NULL;
+    slab->nr_inuse  = 0;
+}
+
+/**
+ * @brief 申请一个新chunk，并将其中所有对象挂到空闲链表
+ *
+ * chunk布局：| 链接下一个chunk(1个缓存行) | obj | obj | ... |
+ *
+ * @param slab
+ * @return int 0成功，否则失败
+ */
+static int nfs_slab_grow(struct nfs_slab* slab) {
+    uint8_t* chunk;
+    uint8_t* obj;
+    int      i;
+    if (posix_memalign((void **)&chunk, NFS_CACHELINE_SZ,
+                       NFS_CACHELINE_SZ + slab->objs_per_chunk * slab->obj_sz) != 0) {
+        return -NFS_ERROR_NOSPACE;
+    }
+    // chunk头部记录chunk链表，卸载时整体释放
+    *(void **)chunk = slab->chunks;
+    slab->chunks    = chunk;
+    // 从后往前挂入空闲链表，使分配顺序与地址顺序一致
+    obj = chunk + NFS_CACHELINE_SZ + (slab->objs_per_chunk - 1) * slab->obj_sz;
+    for (i = 0; i < slab->objs_per_chunk; i++) {
+        *(void **)obj   = slab->free_list;
+        slab->free_list = obj;
+        obj            -= slab->obj_sz;
+    }
+    return NFS_ERROR_NONE;
+}
+
+/**
+ * @brief 从slab中分配一个清零的对象
+ *
+ * @param slab
+ * @return void* 对象指针，空间不足时为NULL
+ */
+void* nfs_slab_alloc(struct nfs_slab* slab) {
+    void* obj;
+    if (slab->free_list == NULL && nfs_slab_grow(slab) != NFS_ERROR_NONE) {
+        return NULL;
+    }
+    obj             = slab->free_list;
+    slab->free_list = *(void **)obj;
+    slab->nr_inuse++;
+    memset(obj, 0, slab->obj_sz);
+    return obj;
+}
+
+/**
+ * @brief 将对象归还slab的空闲链表，不归还系统
+ *
+ * @param slab
+ * @param obj
+ */
+void nfs_slab_free(struct nfs_slab* slab, void* obj) {
+    if (obj == NULL) {
+        return;
+    }
+    *(void **)obj   = slab->free_list;
+    slab->free_list = obj;
+    slab->nr_inuse--;
+}
+
+/**
+ * @brief 一次性释放slab的所有chunk，卸载时调用
+ *
+ * @param slab
+ */
+void nfs_slab_destroy(struct nfs_slab* slab) {
+    void* chunk = slab->chunks;
+    void* next;
+    while (chunk) {
+        next = *(void **)chunk;
+        free(chunk);
+        chunk = next;
+    }
+    slab->chunks    = NULL;
+    slab->free_list = NULL;
+    slab->nr_inuse  = 0;
+}
+
+/**
+ * @brief 初始化文件名arena及其驻留哈希表
+ *
+ * @param arena
+ * @return int 0成功，内存不足时为-NFS_ERROR_NOMEM
+ */
+int nfs_names_init(struct nfs_name_arena* arena) {
+    arena->chunk    = NULL;
+    arena->used     = NFS_NAME_CHUNK_SZ;    // 首次驻留时申请chunk
+    arena->chunks   = NULL;
+    memset(arena->free_names, 0, sizeof(arena->free_names));
+    arena->table_sz = NFS_NAME_TABLE_INIT;
+    arena->table    = (const char **)calloc(arena->table_sz, sizeof(const char *));
+    arena->nr_names = 0;
+    if (arena->table == NULL) {
+        return -NFS_ERROR_NOMEM;
+    }
+    return NFS_ERROR_NONE;
+}
+
+// 由arena中的文件名找到其头部
+static inline struct nfs_name* nfs_name_of(const char* str) {
+    return (struct nfs_name *)(str - offsetof(struct nfs_name, str));
+}
+
+/**
+ * @brief 在arena中存入一个以'\0'结尾的文件名，优先复用同一大小级中已回收的位置
+ *
+ * @param arena
+ * @param name 文件名
+ * @param len 文件名长度
+ * @param hash 文件名哈希
+ * @return struct nfs_name* 内存不足时为NULL
+ */
+static struct nfs_name* nfs_names_append(struct nfs_name_arena* arena, const char* name, int len, uint32_t hash) {
+    int              sz  = NFS_ROUND_UP((int)sizeof(struct nfs_name) + len + 1, NFS_NAME_ALIGN);
+    int              cls = sz / NFS_NAME_ALIGN;
+    struct nfs_name* entry;
+    if (arena->free_names[cls] != NULL) {
+        entry = (struct nfs_name *)arena->free_names[cls];
+        arena->free_names[cls] = *(void **)entry;
+    }
+    else {
+        if (arena->used + sz > NFS_NAME_CHUNK_SZ) {
+            uint8_t* chunk = (uint8_t *)malloc(NFS_NAME_CHUNK_SZ);
+            if (chunk == NULL) {
+                return NULL;
+            }
+            *(void **)chunk = arena->chunks;
+            arena->chunks   = chunk;
+            arena->chunk    = chunk;
+            arena->used     = NFS_ROUND_UP((int)sizeof(void *), NFS_NAME_ALIGN);
+        }
+        entry = (struct nfs_name *)(arena->chunk + arena->used);
+        arena->used += sz;
+    }
+    entry->refcnt = 1;
+    entry->hash   = hash;
+    memcpy(entry->str, name, len);
+    entry->str[len] = '\0';
+    return entry;
+}
+
+// 驻留哈希表扩容为原来两倍，按已存的哈希重新散列
+static int nfs_names_grow(struct nfs_name_arena* arena) {
+    int          new_sz    = arena->table_sz * 2;
+    const char** new_table = (const char **)calloc(new_sz, sizeof(const char *));
+    const char*  str;
+    uint32_t     pos;
+    if (new_table == NULL) {
+        return -NFS_ERROR_NOMEM;
+    }
+    for (int i = 0; i < arena->table_sz; i++) {
+        str = arena->table[i];
+        if (str == NULL) {
+            continue;
+        }
+        pos = nfs_name_of(str)->hash & (new_sz - 1);
+        while (new_table[pos] != NULL) {
+            pos = (pos + 1) & (new_sz - 1);
+        }
+        new_table[pos] = str;
+    }
+    free(arena->table);
+    arena->table    = new_table;
+    arena->table_sz = new_sz;
+    return NFS_ERROR_NONE;
+}
+
+/**
+ * @brief 驻留一个长文件名并增加其引用：已存在则返回已有副本，否则存入arena
+ *
+ * 每次成功驻留须对应一次nfs_name_put
+ *
+ * @param arena
+ * @param name 文件名
+ * @param len 文件名长度
+ * @param hash 文件名哈希
+ * @return const char* arena中的文件名，内存不足时为NULL
+ */
+const char* nfs_name_intern(struct nfs_name_arena* arena, const char* name, int len, uint32_t hash) {
+    uint32_t         pos;
+    const char*      str;
+    struct nfs_name* entry;
+    // 负载超过3/4时扩容，保证线性探测较短；扩容失败时仍可命中已有文件名
+    boolean          full = ((arena->nr_names + 1) * 4 > arena->table_sz * 3) 
+                            && nfs_names_grow(arena) != NFS_ERROR_NONE;
+    pos = hash & (arena->table_sz - 1);
+    while ((str = arena->table[pos]) != NULL) {
+        if (strncmp(str, name, len) == 0 && str[len] == '\0') {   // strncmp在较短的驻留串结尾处停止
+            nfs_name_of(str)->refcnt++;
+            return str;
+        }
+        pos = (pos + 1) & (arena->table_sz - 1);
+    }
+    if (full) {
+        return NULL;
+    }
+    entry = nfs_names_append(arena, name, len, hash);
+    if (entry == NULL) {
+        return NULL;
+    }
+    arena->table[pos] = entry->str;
+    arena->nr_names++;
+    return entry->str;
+}
+
+/**
+ * @brief 释放一次长文件名的引用，最后一个引用释放时移出哈希表并回收其位置
+ *
+ * arena的内存只在卸载时归还系统，回收的位置供同一大小级的文件名复用，
+ * 因此arena的大小受同时存在的长文件名数限制
+ *
+ * @param arena
+ * @param str nfs_name_intern返回的文件名
+ */
+void nfs_name_put(struct nfs_name_arena* arena, const char* str) {
+    struct nfs_name* entry = nfs_name_of(str);
+    uint32_t         mask  = arena->table_sz - 1;
+    uint32_t         hole, pos, home;
+    int              cls;
+    if (--entry->refcnt > 0) {
+        return;
+    }
+    hole = entry->hash & mask;
+    while (arena->table[hole] != str) {
+        hole = (hole + 1) & mask;
+    }
+    // 线性探测的删除：把空位之后、探测起点不在(hole, pos]内的文件名前移填补空位
+    arena->table[hole] = NULL;
+    pos = hole;
+    while (1) {
+        pos = (pos + 1) & mask;
+        if (arena->table[pos] == NULL) {
+            break;
+        }
+        home = nfs_name_of(arena->table[pos])->hash & mask;
+        if (((pos - home) & mask) < ((pos - hole) & mask)) {
+            continue;
+        }
+        arena->table[hole] = arena->table[pos];
+        arena->table[pos]  = NULL;
+        hole = pos;
+    }
+    arena->nr_names--;
+    cls = NFS_ROUND_UP((int)sizeof(struct nfs_name) + (int)strlen(str) + 1, NFS_NAME_ALIGN) / NFS_NAME_ALIGN;
+    *(void **)entry = arena->free_names[cls];
+    arena->free_names[cls] = entry;
+}
+
+/**
+ * @brief 一次性释放文件名arena，卸载时调用
+ *
+ * @param arena
+ */
+void nfs_names_destroy(struct nfs_name_arena* arena) {
+    void* chunk = arena->chunks;
+    void* next;
+    while (chunk) {
+        next = *(void **)chunk;
+        free(chunk);
+        chunk = next;
+    }
+    free(arena->table);
+    memset(arena->free_names, 0, sizeof(arena->free_names));
+    arena->table    = NULL;
+    arena->chunks   = NULL;
+    arena->chunk    = NULL;
+    arena->nr_names = 0;
+}
+
+// 释放dentry对长文件名的引用，内联的短文件名无需释放
+static void nfs_dentry_put_name(struct nfs_dentry* dentry) {
+    if (dentry->fname != NULL && dentry->fname != dentry->fname_inline) {
+        nfs_name_put(&nfs_super.name_arena, dentry->fname);
+    }
+}
+
+/**
+ * @brief 设置dentry的文件名与哈希，短文件名内联存放，长文件名驻留在文件名arena中
+ *
+ * 先取得新文件名再释放旧文件名，失败时dentry保持不变
+ *
+ * @param dentry
+ * @param fname 文件名
+ * @return int 0成功，内存不足时为-NFS_ERROR_NOMEM
+ */
+int nfs_dentry_set_name(struct nfs_dentry* dentry, const char * fname) {
+    int         len  = strlen(fname);
+    uint32_t    hash = nfs_hash_name(fname, len);
+    const char* name = NULL;
+    if (len >= NFS_INLINE_NAME_LEN) {
+        name = nfs_name_intern(&nfs_super.name_arena, fname, len, hash);
+        if (name == NULL) {
+            return -NFS_ERROR_NOMEM;
+        }
+    }
+    nfs_dentry_put_name(dentry);
+    dentry->fname_len = len;
+    dentry->fhash     = hash;
+    if (name == NULL) {
+        memmove(dentry->fname_inline, fname, len + 1);
+        dentry->fname = dentry->fname_inline;
+    }
+    else {
+        dentry->fname = name;
+    }
+    return NFS_ERROR_NONE;
+}
+
+/**
+ * @brief 新建一个内存dentry，从dentry slab中分配
+ * 
+ * 短文件名内联存放在dentry中，长文件名驻留在文件名arena中
+ *
+ * @param fname 文件名
+ * @param ftype 文件类型
+ * @return struct nfs_dentry* 内存不足时为NULL
+ */
+struct nfs_dentry* new_dentry(const char * fname, NFS_FILE_TYPE ftype) {
+    struct nfs_dentry * dentry = (struct nfs_dentry *)nfs_slab_alloc(&nfs_super.dentry_slab);
+    if (dentry == NULL) {
+        return NULL;
+    }
+    if (nfs_dentry_set_name(dentry, fname) != NFS_ERROR_NONE) {    // 长文件名驻留失败
+        nfs_slab_free(&nfs_super.dentry_slab, dentry);
+        return NULL;
+    }
+    dentry->ftype   = ftype;
+    dentry->ino     = -1;
+    dentry->inode   = NULL;
+    dentry->parent  = NULL;
+    dentry->brother = NULL;
+    return dentry;
+}
+
+/**
+ * @brief 释放内存dentry，归还dentry slab并释放其长文件名的引用
+ *
+ * @param dentry
+ */
+void free_dentry(struct nfs_dentry* dentry) {
+    nfs_dentry_put_name(dentry);
+    nfs_slab_free(&nfs_super.dentry_slab, dentry);
+}
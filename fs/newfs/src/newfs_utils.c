@@ -9,6 +9,16 @@ char* nfs_get_fname(const char* path) {
     char *q = strrchr(path, ch) + 1;
     return q;
 }
+// 计算文件名哈希（FNV-1a），查找时先比较哈希再比较文件名
+uint32_t nfs_hash_name(const char* name, int len) {
+    uint32_t hash = 2166136261u;
+    int i;
+    for (i = 0; i < len; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
 /**
  * 计算路径的层级
  * exm: /av/c/d/f
@@ -29,54 +39,19 @@ int nfs_calc_lvl(const char * path) {
     return lvl;
 }
 
-// 驱动读
+// 驱动读，块对齐、缓存与多线程互斥由blkio完成
 int nfs_driver_read(int offset, uint8_t *out_content, int size) {
-    //int      offset_aligned = NFS_ROUND_DOWN(offset, NFS_IO_SZ());
-    int      offset_aligned = NFS_ROUND_DOWN(offset, NFS_BLK_SZ());     // 块大小为1024B
-    int      bias           = offset - offset_aligned;
-    //int      size_aligned   = NFS_ROUND_UP((size + bias), NFS_IO_SZ());
-    int      size_aligned   = NFS_ROUND_UP((size + bias), NFS_BLK_SZ());    // 块大小为1024B
-    uint8_t* temp_content   = (uint8_t*)malloc(size_aligned);
-    uint8_t* cur            = temp_content;
-    // lseek(NFS_DRIVER(), offset_aligned, SEEK_SET);
-    ddriver_seek(NFS_DRIVER(), offset_aligned, SEEK_SET);
-    while (size_aligned != 0)
-    {
-        // read(NFS_DRIVER(), cur, NFS_IO_SZ());
-        // 驱动读写IO单位为512
-        ddriver_read(NFS_DRIVER(), cur, NFS_IO_SZ());
-        cur          += NFS_IO_SZ();
-        size_aligned -= NFS_IO_SZ();   
-    }
-    memcpy(out_content, temp_content + bias, size);
-    free(temp_content);
+    if (blkio_read(&nfs_super.bio, offset, out_content, size) != 0) {
+        return -NFS_ERROR_IO;
+    }
     return NFS_ERROR_NONE;
 }
 
-// 驱动写
+// 驱动写，缓存为写直达，返回时已写到驱动，日志的落盘顺序不变
 int nfs_driver_write(int offset, uint8_t *in_content, int size) {
-    //int      offset_aligned = NFS_ROUND_DOWN(offset, NFS_IO_SZ());
-    int      offset_aligned = NFS_ROUND_DOWN(offset, NFS_BLK_SZ());     // 块大小为1024B
-    int      bias           = offset - offset_aligned;
-    //int      size_aligned   = NFS_ROUND_UP((size + bias), NFS_IO_SZ());
-    int      size_aligned   = NFS_ROUND_UP((size + bias), NFS_BLK_SZ());    // 块大小为1024B
-    uint8_t* temp_content   = (uint8_t*)malloc(size_aligned);
-    uint8_t* cur            = temp_content;
-    nfs_driver_read(offset_aligned, temp_content, size_aligned);
-    memcpy(temp_content + bias, in_content, size);
-    
-    // lseek(NFS_DRIVER(), offset_aligned, SEEK_SET);
-    ddriver_seek(NFS_DRIVER(), offset_aligned, SEEK_SET);
-    while (size_aligned != 0)
-    {
-        // write(NFS_DRIVER(), cur, NFS_IO_SZ());
-        // 驱动读写IO单位为512
-        ddriver_write(NFS_DRIVER(), cur, NFS_IO_SZ());
-        cur          += NFS_IO_SZ();
-        size_aligned -= NFS_IO_SZ();   
+    if (blkio_write(&nfs_super.bio, offset, in_content, size) != 0) {
+        return -NFS_ERROR_IO;
     }
-
-    free(temp_content);
     return NFS_ERROR_NONE;
 }
 
@@ -129,101 +104,273 @@ int nfs_drop_dentry(struct nfs_inode * inode, struct nfs_dentry * dentry) {
 /**
  * @brief 分配一个inode，占用位图
  * 
- * @param dentry 该dentry指向分配的inode
+ * inode与数据块的位置由块组分配器决定，见newfs_alloc.c
+ * 
+ * @param dentry 该dentry指向分配的inode，其parent需已设置（根目录为NULL）
  * @return nfs_inode
  */
 struct nfs_inode* nfs_alloc_inode(struct nfs_dentry * dentry) {
     struct nfs_inode* inode;
-    int byte_cursor = 0; 
-    int bit_cursor  = 0; 
-    // ino编号指针
-    int ino_cursor  = 0;
-    // 数据块编号指针
-    int blockno_cursor  = 0;
+    int parent_ino = -1;
+    int ino_cursor;
+    int blockno_cursor;
 
-    boolean is_find_free_entry = FALSE;
-    boolean is_find_enough_free_block = FALSE;
-
-    // 从inode位图中寻找空闲
-    for (byte_cursor = 0; byte_cursor < NFS_BLKS_SZ(nfs_super.map_inode_blks); 
-         byte_cursor++)
-    {
-        for (bit_cursor = 0; bit_cursor < UINT8_BITS; bit_cursor++) {
-            if((nfs_super.map_inode[byte_cursor] & (0x1 << bit_cursor)) == 0) {    
-                // 找到空闲位置，设为1
-                nfs_super.map_inode[byte_cursor] |= (0x1 << bit_cursor);
-                is_find_free_entry = TRUE;           
-                break;
-            }
-            ino_cursor++;
-        }
-        if (is_find_free_entry) {
-            break;
-        }
+    if (dentry->parent != NULL) {
+        parent_ino = dentry->parent->ino;
     }
+    // 从inode位图中寻找空闲
+    ino_cursor = nfs_new_inode(parent_ino, dentry->ftype == NFS_DIR);
     // 若无空闲，报错
-    if (!is_find_free_entry || ino_cursor == nfs_super.max_ino)
-        return -NFS_ERROR_NOSPACE;
-    // 分配inode并初始化
-    inode = (struct nfs_inode*)malloc(sizeof(struct nfs_inode));
+    if (ino_cursor < 0)
+        return NULL;
+    // 从inode slab分配inode并初始化，内存不足时归还ino
+    inode = (struct nfs_inode*)nfs_slab_alloc(&nfs_super.inode_slab);
+    if (inode == NULL) {
+        nfs_free_inode(ino_cursor, dentry->ftype == NFS_DIR);
+        return NULL;
+    }
     inode->ino  = ino_cursor; 
     inode->size = 0;
     inode->dir_cnt = 0;
     inode->dentrys = NULL;
+    inode->ftype   = dentry->ftype;
+    inode->nlink   = dentry->ftype == NFS_DIR ? 2 : 1;
+    inode->mode    = dentry->ftype == NFS_DIR ? NFS_DIR_PERM : NFS_DEFAULT_PERM;    // 由创建者按参数改写
+    inode->uid     = fuse_get_context()->uid;
+    inode->gid     = fuse_get_context()->gid;
+    clock_gettime(CLOCK_REALTIME, &inode->ctime);
+    inode->mtime   = inode->ctime;
+    inode->atime   = inode->ctime;
     // 使dentry指向inode
     dentry->inode = inode;
     dentry->ino   = inode->ino;
-    // 使inode指回dentry
+    // 使inode指回dentry，并加入inode缓存
     inode->dentry = dentry;
+    nfs_super.icache[inode->ino] = inode;
 
-    // 从数据位图中寻找空闲，共需NFS_DATA_PER_FILE(固定为6)个
-    int cnt = 0;
-    for (byte_cursor = 0; byte_cursor < NFS_BLKS_SZ(nfs_super.map_data_blks); 
-         byte_cursor++)
-    {
-        for (bit_cursor = 0; bit_cursor < UINT8_BITS; bit_cursor++) {
-            if((nfs_super.map_data[byte_cursor] & (0x1 << bit_cursor)) == 0) {    
-                // 找到空闲位置，设为1
-                nfs_super.map_data[byte_cursor] |= (0x1 << bit_cursor);
-                // 记录找到的块号，直到找够
-                inode->blockno[cnt++] = blockno_cursor;
-                if(cnt == NFS_DATA_PER_FILE){
-                    is_find_enough_free_block = TRUE;
-                    break;
+    // 普通文件延迟分配，写回时再分配数据块；符号链接由创建者按目标长度决定是否分配
+    if (dentry->ftype != NFS_DIR) {
+        for (int i = 0; i < NFS_DATA_PER_FILE; i++) {
+            inode->blockno[i] = NFS_BLKNO_NONE;
+        }
+    }
+    // 目录从inode所在块组分配NFS_DATA_PER_FILE个数据块，从块组起始处向后找
+    else {
+        blockno_cursor = NFS_INO_GROUP(ino_cursor) * nfs_super.data_per_group;
+        for (int i = 0; i < NFS_DATA_PER_FILE; i++) {
+            blockno_cursor = nfs_new_block(blockno_cursor);
+            // 若无空闲，归还已分配的块与inode，报错
+            if (blockno_cursor < 0) {
+                while (--i >= 0) {
+                    nfs_free_block(inode->blockno[i]);
                 }
+                nfs_free_inode(ino_cursor, dentry->ftype == NFS_DIR);
+                nfs_super.icache[ino_cursor] = NULL;
+                nfs_slab_free(&nfs_super.inode_slab, inode);
+                dentry->inode = NULL;
+                return NULL;
             }
-            blockno_cursor++;
-        }
-        // 已找够，退出循环
-        if (is_find_enough_free_block) {
-            break;
+            inode->blockno[i] = blockno_cursor;
         }
     }
-    // 若无空闲，报错
-    if (!is_find_enough_free_block || blockno_cursor == nfs_super.max_data)
-        return -NFS_ERROR_NOSPACE;
     
-    // 对于数据块指针block_pointer[]，预分配内存空间
+    // 对于数据块指针block_pointer[]，从blk slab预分配缓冲区
     for(int i = 0; i < NFS_DATA_PER_FILE; i++){
-        inode->block_pointer[i] = (uint8_t*)malloc(NFS_BLK_SZ());
+        inode->block_pointer[i] = (uint8_t*)nfs_slab_alloc(&nfs_super.blk_slab);
+        // 内存不足，归还已分配的缓冲区、数据块与inode，报错
+        if (inode->block_pointer[i] == NULL) {
+            while (--i >= 0) {
+                nfs_slab_free(&nfs_super.blk_slab, inode->block_pointer[i]);
+            }
+            if (NFS_IS_DIR(inode)) {
+                for (int j = 0; j < NFS_DATA_PER_FILE; j++) {
+                    nfs_free_block(inode->blockno[j]);
+                }
+            }
+            nfs_free_inode(ino_cursor, dentry->ftype == NFS_DIR);
+            nfs_super.icache[ino_cursor] = NULL;
+            nfs_slab_free(&nfs_super.inode_slab, inode);
+            dentry->inode = NULL;
+            return NULL;
+        }
+        // 目录块初始化为空闲记录，并标记待写回
+        if (NFS_IS_DIR(inode)) {
+            nfs_dir_init_blk(inode->block_pointer[i]);
+            inode->block_flag[i] |= NFS_FLAG_BUF_DIRTY;
+        }
     }
     return inode;
 }
+/**
+ * @brief 为inode第[first, last)个数据块中尚无磁盘块的块一次分配连续的磁盘块
+ * 
+ * 延迟分配的块（已有数据）分配后标记待写回；prealloc为TRUE时，
+ * 其余未分配的块也一并分配，标记为未写入，读取时返回零且不访问磁盘。
+ * 所需块从前一个已分配块之后（或inode所在块组起始处）连续分配，
+ * 调用者负责记录位图与超级块
+ * 
+ * @param inode 普通文件inode
+ * @param first 起始数据块下标
+ * @param last 结束数据块下标（不含）
+ * @param prealloc 是否为预分配
+ * @return int 新分配的块数，失败时为负的错误码
+ */
+static int nfs_alloc_range(struct nfs_inode * inode, int first, int last, boolean prealloc) {
+    int blknos[NFS_DATA_PER_FILE];
+    int start   = -1;
+    int cnt     = 0;
+    int nr_resv = 0;
+    int goal;
+    int ret;
+    for (int i = first; i < last; i++) {
+        if (inode->blockno[i] != NFS_BLKNO_NONE) {
+            continue;
+        }
+        if (inode->block_flag[i] & NFS_FLAG_BUF_DELAY) {
+            nr_resv++;
+        }
+        else if (!prealloc) {
+            continue;
+        }
+        if (start < 0) {
+            start = i;
+        }
+        cnt++;
+    }
+    if (cnt == 0) {
+        return 0;
+    }
+    goal = NFS_INO_GROUP(inode->ino) * nfs_super.data_per_group;
+    for (int i = start - 1; i >= 0; i--) {
+        if (inode->blockno[i] != NFS_BLKNO_NONE) {
+            goal = inode->blockno[i] + 1;
+            break;
+        }
+    }
+    // 先归还写入时预留的块，再真正分配；预留保证了延迟分配不会因空间不足失败
+    nfs_unresv_blocks(nr_resv);
+    ret = nfs_new_blocks(goal, cnt, blknos);
+    if (ret != NFS_ERROR_NONE) {
+        nfs_resv_blocks(nr_resv);       // 分配失败未占用任何块，恢复预留必然成功
+        return ret;
+    }
+    cnt = 0;
+    for (int i = first; i < last; i++) {
+        if (inode->blockno[i] != NFS_BLKNO_NONE) {
+            continue;
+        }
+        if (inode->block_flag[i] & NFS_FLAG_BUF_DELAY) {
+            inode->blockno[i]     = blknos[cnt++];
+            inode->block_flag[i] &= ~NFS_FLAG_BUF_DELAY;
+            inode->block_flag[i] |= NFS_FLAG_BUF_DIRTY;
+        }
+        else if (prealloc) {
+            inode->blockno[i]     = blknos[cnt++];
+            inode->block_flag[i] |= NFS_FLAG_BUF_UNWRITTEN;
+        }
+    }
+    return cnt;
+}
+/**
+ * @brief 为延迟分配的数据块一次分配磁盘块，写回前调用，此时文件长度已确定
+ * 
+ * @param inode 普通文件inode
+ * @return int 新分配的块数，失败时为负的错误码
+ */
+int nfs_alloc_data(struct nfs_inode * inode) {
+    return nfs_alloc_range(inode, 0, NFS_DATA_PER_FILE, FALSE);
+}
+/**
+ * @brief 为第[first, last)个数据块预分配磁盘块，未写入的块读取时为零
+ * 
+ * @param inode 普通文件inode
+ * @param first 起始数据块下标
+ * @param last 结束数据块下标（不含）
+ * @return int 新分配的块数，失败时为负的错误码
+ */
+int nfs_prealloc_data(struct nfs_inode * inode, int first, int last) {
+    return nfs_alloc_range(inode, first, last, TRUE);
+}
+/**
+ * @brief 将文件截断为size，新文件尾之后的数据块一并释放
+ * 
+ * 尾块中新文件尾之后的内容清零，使文件再次扩展时读到零；
+ * 扩展文件只修改大小，扩展出的部分为空洞
+ * 
+ * @param inode 普通文件inode
+ * @param size 新文件大小
+ * @param blknos 返回被释放的数据块号，调用者据此记录位图
+ * @return int 被释放的块数
+ */
+int nfs_truncate_data(struct nfs_inode * inode, int size, int* blknos) {
+    int nr_blks = NFS_ROUND_UP(size, NFS_BLK_SZ()) / NFS_BLK_SZ();
+    int tail    = size % NFS_BLK_SZ();
+    int cnt     = 0;
+    int nr_resv = 0;
+    if (size >= inode->size) {
+        inode->size = size;
+        return 0;
+    }
+    for (int i = nr_blks; i < NFS_DATA_PER_FILE; i++) {
+        if (inode->blockno[i] != NFS_BLKNO_NONE) {
+            blknos[cnt++] = inode->blockno[i];
+        }
+        if (inode->block_flag[i] & NFS_FLAG_BUF_DELAY) {
+            nr_resv++;
+        }
+        inode->blockno[i]    = NFS_BLKNO_NONE;
+        inode->block_flag[i] = 0;
+        memset(inode->block_pointer[i], 0, NFS_BLK_SZ());
+    }
+    nfs_unresv_blocks(nr_resv);
+    nfs_free_blocks(blknos, cnt);
+    if (tail != 0) {
+        memset(inode->block_pointer[nr_blks - 1] + tail, 0, NFS_BLK_SZ() - tail);
+        if (NFS_BLK_HAS_DATA(inode, nr_blks - 1) && inode->blockno[nr_blks - 1] != NFS_BLKNO_NONE) {
+            inode->block_flag[nr_blks - 1] |= NFS_FLAG_BUF_DIRTY;
+        }
+    }
+    inode->size = size;
+    return cnt;
+}
+// 将内存inode的属性填入磁盘inode_d，同步与写日志共用
+void nfs_pack_inode(struct nfs_inode * inode, struct nfs_inode_d * inode_d) {
+    inode_d->ino        = inode->ino;
+    inode_d->size       = inode->size;
+    inode_d->ftype      = inode->ftype;
+    inode_d->dir_cnt    = inode->dir_cnt;
+    inode_d->nlink      = inode->nlink;
+    inode_d->mode       = inode->mode;
+    inode_d->uid        = inode->uid;
+    inode_d->gid        = inode->gid;
+    inode_d->atime      = inode->atime;
+    inode_d->mtime      = inode->mtime;
+    inode_d->ctime      = inode->ctime;
+    inode_d->unwritten  = 0;
+    inode_d->next_orphan = inode->orphan_next != NULL ? inode->orphan_next->ino : -1;
+    // 短符号链接目标内联存放，不占用数据块
+    if (NFS_IS_FAST_LINK(inode)) {
+        memcpy(inode_d->link, inode->block_pointer[0], inode->size + 1);
+    }
+    for (int i = 0; i < NFS_DATA_PER_FILE; i++) {
+        inode_d->blockno[i] = inode->blockno[i];
+        if (inode->block_flag[i] & NFS_FLAG_BUF_UNWRITTEN) {
+            inode_d->unwritten |= 0x1 << i;
+        }
+    }
+}
 // 将内存中的inode及其中待同步数据与磁盘中的inode_d同步
 int nfs_sync_inode(struct nfs_inode * inode) {
     struct nfs_inode_d  inode_d;
     struct nfs_dentry*  dentry_cursor;
-    struct nfs_dentry_d dentry_d;
     int ino             = inode->ino;
-    // 同步相关属性
-    inode_d.ino         = ino;
-    inode_d.size        = inode->size;
-    inode_d.ftype       = inode->dentry->ftype;
-    inode_d.dir_cnt     = inode->dir_cnt;
-    for (int i = 0; i < NFS_DATA_PER_FILE; i++) {
-        inode_d.blockno[i] = inode->blockno[i];
+    // 文件先分配延迟分配的数据块，使写回的inode含有其块号
+    if (NFS_IS_REG(inode) && nfs_alloc_data(inode) < 0) {
+        NFS_DBG("[%s] no space\n", __func__);
+        return -NFS_ERROR_NOSPACE;
     }
-    int offset;
+    // 同步相关属性
+    nfs_pack_inode(inode, &inode_d);
     
     // 写回inode
     if (nfs_driver_write(NFS_INO_OFS(ino), (uint8_t *)&inode_d, 
@@ -232,28 +379,22 @@ int nfs_sync_inode(struct nfs_inode * inode) {
         return -NFS_ERROR_IO;
     }
 
-    // 对于目录，逐条写回子目录项
+    // 对于目录，只写回被修改过的目录块
     if (NFS_IS_DIR(inode)) {
-        int blockno_cursor = 0;
-        dentry_cursor = inode->dentrys;
-        offset        = NFS_DATA_OFS(inode->blockno[blockno_cursor]);
-        while (dentry_cursor != NULL)
-        {
-            // 若当前块剩余空间不足，切换至下一块
-            if(offset + sizeof(struct nfs_dentry_d) >= NFS_DATA_OFS(inode->blockno[blockno_cursor] + 1)){
-                blockno_cursor++;
-                offset = NFS_DATA_OFS(inode->blockno[blockno_cursor]);
+        for (int i = 0; i < NFS_DATA_PER_FILE; i++) {
+            if (!(inode->block_flag[i] & NFS_FLAG_BUF_DIRTY)) {
+                continue;
             }
-            // 复制子文件的信息至dentry_d
-            memcpy(dentry_d.fname, dentry_cursor->fname, NFS_MAX_FILE_NAME);
-            dentry_d.ftype = dentry_cursor->ftype;
-            dentry_d.ino = dentry_cursor->ino;
-            // 写回dentry_d
-            if (nfs_driver_write(offset, (uint8_t *)&dentry_d, sizeof(struct nfs_dentry_d)) != NFS_ERROR_NONE) {
+            if (nfs_driver_write(NFS_DATA_OFS(inode->blockno[i]), inode->block_pointer[i],
+                                 NFS_BLKS_SZ(1)) != NFS_ERROR_NONE) {
                 NFS_DBG("[%s] io error\n", __func__);
                 return -NFS_ERROR_IO;                     
             }
-            offset += sizeof(struct nfs_dentry_d);
+            inode->block_flag[i] &= ~NFS_FLAG_BUF_DIRTY;
+        }
+        dentry_cursor = inode->dentrys;
+        while (dentry_cursor != NULL)
+        {
             // 递归同步子文件inode
             if (dentry_cursor->inode != NULL) {
                 nfs_sync_inode(dentry_cursor->inode);
@@ -262,22 +403,119 @@ int nfs_sync_inode(struct nfs_inode * inode) {
             dentry_cursor = dentry_cursor->brother;
         }
     }
-    // 对于文件类型，直接复制数据
+    // 对于文件类型，写回脏数据块
     else if (NFS_IS_REG(inode)) {
-        // 写数据，复制数据块
-        for (int i = 0; i < NFS_DATA_PER_FILE; i++)
-        {
-            if (nfs_driver_write(NFS_DATA_OFS(inode->blockno[i]), (uint8_t *)inode->block_pointer[i],
-                             NFS_BLKS_SZ(1)) != NFS_ERROR_NONE) {
-                NFS_DBG("[%s] io error\n", __func__);
-                return -NFS_ERROR_IO;
-            }
+        return nfs_sync_data(inode);
+    }
+    return NFS_ERROR_NONE;
+}
+// 将文件被修改过的数据块原地写回，fsync与卸载共用
+int nfs_sync_data(struct nfs_inode * inode) {
+    for (int i = 0; i < NFS_DATA_PER_FILE; i++)
+    {
+        // 尚未分配磁盘块的延迟数据需先经nfs_alloc_data分配
+        if (!(inode->block_flag[i] & NFS_FLAG_BUF_DIRTY) || inode->blockno[i] == NFS_BLKNO_NONE) {
+            continue;
+        }
+        if (nfs_driver_write(NFS_DATA_OFS(inode->blockno[i]), (uint8_t *)inode->block_pointer[i],
+                         NFS_BLKS_SZ(1)) != NFS_ERROR_NONE) {
+            NFS_DBG("[%s] io error\n", __func__);
+            return -NFS_ERROR_IO;
         }
+        inode->block_flag[i] &= ~NFS_FLAG_BUF_DIRTY;
     }
     return NFS_ERROR_NONE;
 }
 /**
- * @brief 删除内存中的一个inode， 暂时不释放
+ * @brief 更新inode的ctime，mtime为TRUE时一并更新mtime，并标记属性待记录
+ *
+ * @param inode
+ * @param mtime 内容是否被修改
+ */
+void nfs_touch_inode(struct nfs_inode * inode, boolean mtime) {
+    clock_gettime(CLOCK_REALTIME, &inode->ctime);
+    if (mtime) {
+        inode->mtime = inode->ctime;
+    }
+    inode->dirty = TRUE;
+}
+/**
+ * @brief 读取后按atime策略更新访问时间，只标记待记录，随flush/fsync或卸载写回
+ * 
+ * relatime下仅当atime不晚于mtime或ctime，或已超过一天未更新时才修改，
+ * 反复读取同一文件不会每次都弄脏inode
+ * 
+ * @param inode
+ */
+void nfs_update_atime(struct nfs_inode * inode) {
+    struct timespec now;
+    if (nfs_options.atime == NFS_ATIME_NOATIME) {
+        return;
+    }
+    clock_gettime(CLOCK_REALTIME, &now);
+    if (nfs_options.atime == NFS_ATIME_RELATIME &&
+        NFS_TIME_CMP(inode->atime, inode->mtime) > 0 &&
+        NFS_TIME_CMP(inode->atime, inode->ctime) > 0 &&
+        now.tv_sec - inode->atime.tv_sec < NFS_RELATIME_SEC) {
+        return;
+    }
+    inode->atime = now;
+    inode->dirty = TRUE;
+}
+/**
+ * @brief 将dentry从父目录中摘除，其inode挂入孤儿链表，交由回收线程释放，调用者需处于元数据操作中
+ *
+ * @param dentry 非根目录的dentry，摘除后仍由其inode引用
+ * @return int 0成功，否则失败
+ */
+int nfs_detach_dentry(struct nfs_dentry * dentry) {
+    struct nfs_inode* parent = dentry->parent->inode;
+    int ret;
+    ret = nfs_dir_del_rec(parent, dentry);          // 原地删除父目录块中的记录
+    if (ret != NFS_ERROR_NONE) {
+        return ret;
+    }
+    nfs_drop_dentry(parent, dentry);
+    nfs_put_dentry(dentry);
+    nfs_touch_inode(parent, TRUE);
+    nfs_jnl_dirty_inode(parent);                    // 父目录inode与目录块
+    return NFS_ERROR_NONE;
+}
+/**
+ * @brief 去掉dentry这个名字，链接数减1。文件仍有其他名字时只释放dentry并记录inode，
+ * 否则inode挂入孤儿链表交由回收线程释放
+ *
+ * 调用者已从父目录块与父目录的dentrys中删除该dentry，处于元数据操作中，并负责记录父目录
+ *
+ * @param dentry 
+ */
+void nfs_put_dentry(struct nfs_dentry * dentry) {
+    struct nfs_inode* inode  = dentry->inode;
+    struct nfs_inode* parent = dentry->parent->inode;
+    if (NFS_IS_DIR(inode)) {
+        parent->nlink--;                            // 子目录不再链接父目录
+        inode->nlink = 0;
+    }
+    else {
+        inode->nlink--;
+    }
+    dentry->parent  = NULL;
+    dentry->brother = NULL;
+    if (inode->nlink > 0) {
+        if (inode->dentry == dentry) {
+            inode->dentry = NULL;
+        }
+        free_dentry(dentry);
+        nfs_touch_inode(inode, FALSE);
+        nfs_jnl_dirty_inode(inode);
+        return;
+    }
+    // 最后一个名字，inode经由该dentry进入孤儿链表
+    inode->dentry = dentry;
+    nfs_reclaim_add(inode);                         // 孤儿inode与超级块中的链表头
+}
+/**
+ * @brief 删除内存中的一个inode，其ino与数据块记入batch，由调用者排序后批量释放
  * Case 1: Reg File
  * 
  *                  Inode
@@ -286,7 +524,7 @@ int nfs_sync_inode(struct nfs_inode * inode) {
  *                       |
  *                      Inode  (Reg File)
  * 
- *  1) Step 1. Erase Bitmap     
+ *  1) Step 1. Collect ino and data blocks into batch
  *  2) Step 2. Free Inode                      (Function of nfs_drop_inode)
  * ------------------------------------------------------------------------
  *  3) *Setp 3. Free Dentry belonging to Inode (Outsider)
@@ -300,78 +538,100 @@ int nfs_sync_inode(struct nfs_inode * inode) {
  *                    /     \
  *                Dentry -> Dentry
  * 
- *   Recursive
+ *   Recursive，尚未读入的子inode先从磁盘读入
  * @param inode 
+ * @param batch 待释放的ino与数据块
  * @return int 
  */
-int nfs_drop_inode(struct nfs_inode * inode) {
+int nfs_drop_inode(struct nfs_inode * inode, struct nfs_free_batch * batch) {
     struct nfs_dentry*  dentry_cursor;
     struct nfs_dentry*  dentry_to_free;
-    struct nfs_inode*   inode_cursor;
-
-    int byte_cursor = 0; 
-    int bit_cursor  = 0;
-    int ino_cursor  = 0;
-    int blockno_cursor  = 0;
-    boolean is_find = FALSE;
     // inode为根目录，报错
     if (inode == nfs_super.root_dentry->inode) {
-        return NFS_ERROR_INVAL;
+        return -NFS_ERROR_INVAL;
     }
-    // inode为目录
+    // inode为目录，递归向下drop
     if (NFS_IS_DIR(inode)) {
         dentry_cursor = inode->dentrys;
-        // 递归向下drop
         while (dentry_cursor)
         {
-            inode_cursor = dentry_cursor->inode;
-            nfs_drop_inode(inode_cursor);
-            nfs_drop_dentry(inode, dentry_cursor);
-            dentry_to_free = dentry_cursor;
-            dentry_cursor = dentry_cursor->brother;
-            free(dentry_to_free);
-        }
-    }
-    // inode为文件
-    else if (NFS_IS_REG(inode)) {
-        // 调整inode位图
-        for (byte_cursor = 0; byte_cursor < NFS_BLKS_SZ(nfs_super.map_inode_blks); 
-            byte_cursor++)                            
-        {
-            for (bit_cursor = 0; bit_cursor < UINT8_BITS; bit_cursor++) {
-                if (ino_cursor == inode->ino) {
-                     nfs_super.map_inode[byte_cursor] &= (uint8_t)(~(0x1 << bit_cursor));
-                     is_find = TRUE;
-                     break;
+            if (dentry_cursor->inode == NULL) {
+                dentry_cursor->inode = nfs_read_inode(dentry_cursor, dentry_cursor->ino);
+            }
+            // 仍有其他名字的文件只减少链接数，由其他名字所在目录负责写回
+            if (dentry_cursor->inode != NULL && !NFS_IS_DIR(dentry_cursor->inode) &&
+                --dentry_cursor->inode->nlink > 0) {
+                if (dentry_cursor->inode->dentry == dentry_cursor) {
+                    dentry_cursor->inode->dentry = NULL;
                 }
-                ino_cursor++;
             }
-            if (is_find == TRUE) {
-                break;
+            else if (dentry_cursor->inode != NULL) {
+                nfs_drop_inode(dentry_cursor->inode, batch);
             }
+            dentry_to_free = dentry_cursor;
+            dentry_cursor  = dentry_cursor->brother;
+            free_dentry(dentry_to_free);
         }
-        // 释放数据块，todo
-        
-        // 最后释放inode
-        free(inode);
+        inode->dentrys = NULL;
+        inode->dir_cnt = 0;
+        nfs_batch_add_ino(batch, inode->ino, TRUE);
+    }
+    else {
+        nfs_batch_add_ino(batch, inode->ino, FALSE);
+    }
+    // 收集数据块，归还延迟分配的预留块与数据块缓冲区，最后释放inode
+    for (int i = 0; i < NFS_DATA_PER_FILE; i++) {
+        if (inode->blockno[i] != NFS_BLKNO_NONE) {
+            nfs_batch_add_blk(batch, inode->blockno[i]);
+        }
+        if (inode->block_flag[i] & NFS_FLAG_BUF_DELAY) {
+            nfs_unresv_blocks(1);
+        }
+        nfs_slab_free(&nfs_super.blk_slab, inode->block_pointer[i]);
     }
+    nfs_super.icache[inode->ino] = NULL;
+    nfs_slab_free(&nfs_super.inode_slab, inode);
     return NFS_ERROR_NONE;
 }
+// 读入inode失败时释放已分配的缓冲区、已解析的子dentry与inode本身
+static void nfs_read_inode_fail(struct nfs_inode * inode) {
+    struct nfs_dentry* dentry_cursor = inode->dentrys;
+    struct nfs_dentry* dentry_to_free;
+    while (dentry_cursor) {
+        dentry_to_free = dentry_cursor;
+        dentry_cursor  = dentry_cursor->brother;
+        free_dentry(dentry_to_free);
+    }
+    for (int i = 0; i < NFS_DATA_PER_FILE; i++) {
+        nfs_slab_free(&nfs_super.blk_slab, inode->block_pointer[i]);
+    }
+    nfs_slab_free(&nfs_super.inode_slab, inode);
+}
 /**
- * @brief 
+ * @brief 读入inode，目录同时解析目录块
  * 
- * @param dentry dentry指向ino，读取该inode
- * @param ino inode唯一编号
- * @return struct nfs_inode* 
+ * @param dentry 
+ * @param ino 
+ * @return struct nfs_inode* IO错误或内存不足时为NULL
  */
 struct nfs_inode* nfs_read_inode(struct nfs_dentry * dentry, int ino) {
-    struct nfs_inode* inode = (struct nfs_inode*)malloc(sizeof(struct nfs_inode));
+    struct nfs_inode* inode = nfs_super.icache[ino];
     struct nfs_inode_d inode_d;
-    struct nfs_dentry* sub_dentry;
-    struct nfs_dentry_d dentry_d;
+    // 已经由同一文件的其他名字读入，共享该inode
+    if (inode != NULL) {
+        if (inode->dentry == NULL) {
+            inode->dentry = dentry;
+        }
+        return inode;
+    }
+    inode = (struct nfs_inode*)nfs_slab_alloc(&nfs_super.inode_slab);
+    if (inode == NULL) {
+        return NULL;
+    }
     if (nfs_driver_read(NFS_INO_OFS(ino), (uint8_t *)&inode_d, 
                         sizeof(struct nfs_inode_d)) != NFS_ERROR_NONE) {
         NFS_DBG("[%s] io error\n", __func__);
+        nfs_read_inode_fail(inode);
         return NULL;                    
     }
 
@@ -379,52 +639,66 @@ struct nfs_inode* nfs_read_inode(struct nfs_dentry * dentry, int ino) {
     inode->dir_cnt = 0;
     inode->ino = inode_d.ino;
     inode->size = inode_d.size;
+    inode->ftype = inode_d.ftype;
+    inode->nlink = inode_d.nlink;
+    inode->mode  = inode_d.mode;
+    inode->uid   = inode_d.uid;
+    inode->gid   = inode_d.gid;
+    inode->atime = inode_d.atime;
+    inode->mtime = inode_d.mtime;
+    inode->ctime = inode_d.ctime;
     inode->dentry = dentry;
     inode->dentrys = NULL;
     for(int i = 0 ;i < NFS_DATA_PER_FILE; i++){
         inode->blockno[i] = inode_d.blockno[i];
+        if (inode_d.unwritten & (0x1 << i)) {
+            inode->block_flag[i] |= NFS_FLAG_BUF_UNWRITTEN;
+        }
     }
 
     // 若inode为目录
     if (NFS_IS_DIR(inode)) {
-        // 逐条复制子目录项
-        
-        inode->dir_cnt = inode_d.dir_cnt;
-        int blockno_cursor = 0;
-        int offset = NFS_DATA_OFS(inode->blockno[blockno_cursor]);
-
-        for (int i = 0; i < inode->dir_cnt; i++)
-        {   
-            // 若一块已读完，选择下一块
-            if(offset + sizeof(struct nfs_dentry_d) >=  NFS_DATA_OFS(inode->blockno[blockno_cursor] + 1)){
-                blockno_cursor++;
-                offset = NFS_DATA_OFS(inode->blockno[blockno_cursor]);
-            }
-            // 读取dentry_d
-            if (nfs_driver_read(offset, (uint8_t *)&dentry_d, sizeof(struct nfs_dentry_d)) != NFS_ERROR_NONE) {
+        // 整块读入目录块，再解析其中的变长记录，dir_cnt由解析过程累加
+        for (int i = 0; i < NFS_DATA_PER_FILE; i++) {
+            inode->block_pointer[i] = (uint8_t *)nfs_slab_alloc(&nfs_super.blk_slab);
+            if (inode->block_pointer[i] == NULL ||
+                nfs_driver_read(NFS_DATA_OFS(inode->blockno[i]), inode->block_pointer[i],
+                                NFS_BLKS_SZ(1)) != NFS_ERROR_NONE) {
                 NFS_DBG("[%s] io error\n", __func__);
-                return -NFS_ERROR_IO;                    
+                nfs_read_inode_fail(inode);
+                return NULL;
             }
-            offset += sizeof(struct nfs_dentry_d);
-            // 根据dentry_d为子目录项创建新内存目录项
-            sub_dentry = new_dentry(dentry_d.fname, dentry_d.ftype);
-            sub_dentry->parent = inode->dentry;
-            sub_dentry->ino    = dentry_d.ino; 
-            nfs_alloc_dentry(inode, sub_dentry);
+        }
+        if (nfs_dir_load(inode) < 0) {
+            nfs_read_inode_fail(inode);
+            return NULL;
         }
     }
-    // 若inode为文件
-    else if (NFS_IS_REG(inode)) {
-        // 复制数据
+    // 若inode为文件或符号链接
+    else {
+        // 复制数据，未分配与预分配未写入的块保持为零；长符号链接目标在第0块
         for(int i = 0; i < NFS_DATA_PER_FILE; i++){
-            inode->block_pointer[i] = (uint8_t *)malloc(NFS_BLK_SZ());
+            inode->block_pointer[i] = (uint8_t *)nfs_slab_alloc(&nfs_super.blk_slab);
+            if (inode->block_pointer[i] == NULL) {
+                nfs_read_inode_fail(inode);
+                return NULL;
+            }
+            if (inode->blockno[i] == NFS_BLKNO_NONE || (inode->block_flag[i] & NFS_FLAG_BUF_UNWRITTEN)) {
+                continue;
+            }
             if (nfs_driver_read(NFS_DATA_OFS(inode->blockno[i]), (uint8_t *)inode->block_pointer[i], 
                             NFS_BLKS_SZ(1)) != NFS_ERROR_NONE) {
             NFS_DBG("[%s] io error\n", __func__);
+            nfs_read_inode_fail(inode);
             return NULL;                    
             }
         }
+        // 短符号链接目标从inode复制到缓冲区，readlink直接从内存返回
+        if (NFS_IS_FAST_LINK(inode)) {
+            memcpy(inode->block_pointer[0], inode_d.link, inode->size + 1);
+        }
     }
+    nfs_super.icache[ino] = inode;
     return inode;
 }
 
@@ -468,9 +742,10 @@ struct nfs_dentry* nfs_lookup(const char * path, boolean* is_find, boolean* is_r
     int   lvl = 0;
     boolean is_hit;
     char* fname = NULL;
-    char* path_cpy = (char*)malloc(sizeof(path));
+    int   fname_len;
+    uint32_t fhash;
+    char* path_cpy = strdup(path);
     *is_root = FALSE;
-    strcpy(path_cpy, path);
     
     // 层级为0，所寻找的为根目录
     if (total_lvl == 0) {
@@ -485,25 +760,32 @@ struct nfs_dentry* nfs_lookup(const char * path, boolean* is_find, boolean* is_r
         lvl++;
         // Cache机制，没有实现cache所以直接无视
         if (dentry_cursor->inode == NULL) {
-            nfs_read_inode(dentry_cursor, dentry_cursor->ino);
+            dentry_cursor->inode = nfs_read_inode(dentry_cursor, dentry_cursor->ino);
+            if (dentry_cursor->inode == NULL) {
+                free(path_cpy);
+                return NULL;
+            }
         }
         // 向下寻找过程中最深的匹配节点（以根节点开始）
         inode = dentry_cursor->inode;
         // 深度未达到，路径中的目录名却与文件名匹配，非目标所求
         // 返回值为该文件的dentry
-        if (NFS_IS_REG(inode) && lvl < total_lvl) {
+        if (!NFS_IS_DIR(inode) && lvl < total_lvl) {
             NFS_DBG("[%s] not a dir\n", __func__);
-            dentry_ret = inode->dentry;
+            dentry_ret = dentry_cursor;
             break;
         }
         // 当前匹配节点为目录
         if (NFS_IS_DIR(inode)) {
-            // 遍历目录中所有目录项，匹配下一级
+            // 遍历目录中所有目录项，匹配下一级，哈希与长度都相同才比较文件名
             dentry_cursor = inode->dentrys;
             is_hit        = FALSE;
+            fname_len     = strlen(fname);
+            fhash         = nfs_hash_name(fname, fname_len);
             while (dentry_cursor)
             {
-                if (memcmp(dentry_cursor->fname, fname, strlen(fname)) == 0) {
+                if (dentry_cursor->fhash == fhash && dentry_cursor->fname_len == fname_len &&
+                    memcmp(dentry_cursor->fname, fname, fname_len) == 0) {
                     is_hit = TRUE;
                     break;
                 }
@@ -533,18 +815,74 @@ struct nfs_dentry* nfs_lookup(const char * path, boolean* is_find, boolean* is_r
         dentry_ret->inode = nfs_read_inode(dentry_ret, dentry_ret->ino);
     }
     
-    return dentry_ret;
+    free(path_cpy);
+    return dentry_ret->inode != NULL ? dentry_ret : NULL;
+}
+// 判断dir是否为path的上一级目录，用于确认查找未命中时返回的正是其父目录
+boolean nfs_is_parent(struct nfs_dentry* dir, const char* path) {
+    int lvl = 0;
+    while (dir->parent != NULL) {
+        dir = dir->parent;
+        lvl++;
+    }
+    return lvl + 1 == nfs_calc_lvl(path);
+}
+// 将内存超级块的布局与空闲统计填入磁盘超级块super_d，同步与写日志共用
+void nfs_pack_super(struct nfs_super_d * super_d) {
+    super_d->magic_num           = NFS_MAGIC_NUM;
+    super_d->journal_blks        = nfs_super.journal_blks;
+    super_d->journal_offset      = nfs_super.journal_offset;
+    super_d->map_inode_blks      = nfs_super.map_inode_blks;
+    super_d->map_inode_offset    = nfs_super.map_inode_offset;
+    super_d->map_data_blks       = nfs_super.map_data_blks;
+    super_d->map_data_offset     = nfs_super.map_data_offset;
+    super_d->nr_groups           = nfs_super.nr_groups;
+    super_d->inodes_per_group    = nfs_super.inodes_per_group;
+    super_d->data_per_group      = nfs_super.data_per_group;
+    super_d->group_offset        = nfs_super.group_offset;
+    super_d->free_inodes         = nfs_super.free_inodes;
+    super_d->free_blks           = nfs_super.free_blks;
+    super_d->orphan_head         = nfs_super.reclaim.orphans != NULL ? nfs_super.reclaim.orphans->ino : -1;
+    nfs_groups_pack(super_d->groups);
+}
+/**
+ * @brief 将内存超级块与位图写回磁盘
+ * 
+ * @return int 0成功，否则失败
+ */
+int nfs_sync_super() {
+    struct nfs_super_d  nfs_super_d; 
+    // 磁盘超级块nfs_super_d数据同步内存超级块nfs_super
+    nfs_pack_super(&nfs_super_d);
+
+    // 写回超级块
+    if (nfs_driver_write(NFS_SUPER_OFS, (uint8_t *)&nfs_super_d, 
+                     sizeof(struct nfs_super_d)) != NFS_ERROR_NONE) {
+        return -NFS_ERROR_IO;
+    }
+    // 写回inode位图
+    if (nfs_driver_write(nfs_super_d.map_inode_offset, (uint8_t *)(nfs_super.map_inode), 
+                         NFS_BLKS_SZ(nfs_super_d.map_inode_blks)) != NFS_ERROR_NONE) {
+        return -NFS_ERROR_IO;
+    }
+    // 写回数据位图
+    if (nfs_driver_write(nfs_super_d.map_data_offset, (uint8_t *)(nfs_super.map_data), 
+                         NFS_BLKS_SZ(nfs_super_d.map_data_blks)) != NFS_ERROR_NONE) {
+        return -NFS_ERROR_IO;
+    }
+    return NFS_ERROR_NONE;
 }
 /**
  * @brief 挂载nfs, Layout 如下
  * 
  * Layout
- * | Super | Inode Map | Data Map | Inode | Data |
+ * | Super | Journal | Inode Map | Data Map | Inode | Data |
  * 
  * IO_SZ = 512B
  * BLK_SZ = 1024B
  * 
  * 每个Inode占用一个Blk
+ * 挂载时先重放日志，再读取位图与根目录
  */
 int nfs_mount(struct custom_options options){
     int                 ret = NFS_ERROR_NONE;
@@ -553,14 +891,15 @@ int nfs_mount(struct custom_options options){
     struct nfs_dentry*  root_dentry;
     struct nfs_inode*   root_inode;
 
-    int                 inode_blks;
     int                 map_inode_blks;
-    int                 data_blks;
     int                 map_data_blks;
     int                 super_blks;
+    int                 journal_blks;
+    uint32_t            jnl_seq = 1;
     boolean             is_init = FALSE;
 
     nfs_super.is_mounted = FALSE;
+    nfs_super.reclaim.orphans = NULL;
 
     // 打开驱动
     driver_fd = ddriver_open(options.device);
@@ -572,9 +911,25 @@ int nfs_mount(struct custom_options options){
     ddriver_ioctl(NFS_DRIVER(), IOC_REQ_DEVICE_SIZE,  &nfs_super.sz_disk);
     ddriver_ioctl(NFS_DRIVER(), IOC_REQ_DEVICE_IO_SZ, &nfs_super.sz_io);
     nfs_super.sz_blk = nfs_super.sz_io * 2; // ext2文件系统块大小为1024B
+    if (blkio_init(&nfs_super.bio, NFS_DRIVER(), NFS_BLK_SZ(),
+                   NFS_BIO_CACHE_BLKS, NFS_BIO_RA_BLKS) != 0) {
+        ddriver_close(NFS_DRIVER());
+        return -NFS_ERROR_IO;
+    }
+
+    // 初始化dentry、inode与数据块缓冲区的slab缓存
+    nfs_slab_init(&nfs_super.dentry_slab, sizeof(struct nfs_dentry));
+    nfs_slab_init(&nfs_super.inode_slab, sizeof(struct nfs_inode));
+    nfs_slab_init(&nfs_super.blk_slab, NFS_BLK_SZ());
+    if (nfs_names_init(&nfs_super.name_arena) != NFS_ERROR_NONE) {
+        return -NFS_ERROR_NOMEM;
+    }
     
     // 创建根目录dentry
     root_dentry = new_dentry("/", NFS_DIR);
+    if (root_dentry == NULL) {
+        return -NFS_ERROR_NOMEM;
+    }
 
     // 读取磁盘超级块暂存至内存
     if (nfs_driver_read(NFS_SUPER_OFS, (uint8_t *)(&nfs_super_d), 
@@ -582,41 +937,58 @@ int nfs_mount(struct custom_options options){
         return -NFS_ERROR_IO;
     }
 
+    // 已格式化的磁盘先重放日志，日志可能更新了超级块，需重新读取
+    if (nfs_super_d.magic_num == NFS_MAGIC_NUM) {
+        ret = nfs_jnl_replay(nfs_super_d.journal_offset, nfs_super_d.journal_blks, &jnl_seq);
+        if (ret < 0) {
+            return ret;
+        }
+        ret = NFS_ERROR_NONE;
+        if (nfs_driver_read(NFS_SUPER_OFS, (uint8_t *)(&nfs_super_d), 
+                            sizeof(struct nfs_super_d)) != NFS_ERROR_NONE) {
+            return -NFS_ERROR_IO;
+        }
+    }
     // 若无幻数，即第一次读取磁盘，需初始化
-    if (nfs_super_d.magic_num != NFS_MAGIC_NUM) {
+    else {
         // 直接规定各部分大小
         super_blks = NFS_SUPER_BLK;     // 超级块占用1块
-        inode_blks  =  NFS_INODE_BLK;    // inode数量
-        map_inode_blks = NFS_MAP_INODE_BLK; // inode位图占用1块
-        data_blks = NFS_DATA_BLK;        // 数据块数量
-        map_data_blks = NFS_MAP_DATA_BLK;   // 数据位图占用1块
-
-        // 设置内存超级块属性
-        nfs_super.max_ino = inode_blks;
-        nfs_super.max_data = data_blks;
+        journal_blks = NFS_JOURNAL_BLK; // 日志区块数
+        map_inode_blks = NFS_MAP_INODE_BLK; // inode位图每个块组占用1块
+        map_data_blks = NFS_MAP_DATA_BLK;   // 数据位图每个块组占用1块
 
         // 暂存在内存的磁盘超级块layout
         nfs_super_d.magic_num = NFS_MAGIC_NUM;          // 幻数
-        nfs_super_d.sz_usage = 0;    // 已用空间大小
 
-        nfs_super_d.map_inode_blks = map_inode_blks;   // inode位图占用1块
-        nfs_super_d.map_inode_offset = NFS_SUPER_OFS + NFS_BLKS_SZ(super_blks); // inode位图起始位置，在超级块之后
+        nfs_super_d.journal_blks = journal_blks;    // 日志区块数
+        nfs_super_d.journal_offset = NFS_SUPER_OFS + NFS_BLKS_SZ(super_blks);   // 日志区起始位置，在超级块之后
+
+        nfs_super_d.map_inode_blks = map_inode_blks;   // inode位图占用块数
+        nfs_super_d.map_inode_offset = nfs_super_d.journal_offset + NFS_BLKS_SZ(journal_blks); // inode位图起始位置，在日志区之后
 
-        nfs_super_d.map_data_blks = map_data_blks;  // 数据位图占用1块
+        nfs_super_d.map_data_blks = map_data_blks;  // 数据位图占用块数
         nfs_super_d.map_data_offset = nfs_super_d.map_inode_offset + NFS_BLKS_SZ(map_inode_blks);// 数据位图起始位置，在inode位图之后
 
-        nfs_super_d.inode_offset = nfs_super_d.map_data_offset + NFS_BLKS_SZ(map_data_blks);    // inode块起始位置，在数据位图之后
-        nfs_super_d.data_offset = nfs_super_d.inode_offset + NFS_BLKS_SZ(inode_blks);    // 数据块起始位置，在所有inode块之后
+        nfs_super_d.nr_groups = NFS_GROUP_CNT;      // 块组数
+        nfs_super_d.inodes_per_group = NFS_INODES_PER_GROUP;    // 每个块组的inode表块数
+        nfs_super_d.data_per_group = NFS_DATA_PER_GROUP;        // 每个块组的数据块数
+        nfs_super_d.group_offset = nfs_super_d.map_data_offset + NFS_BLKS_SZ(map_data_blks);    // 块组起始位置，在数据位图之后
         
         is_init = TRUE;
     }
     
+    // 超级块中块组统计数组的长度固定为NFS_GROUP_CNT
+    if (nfs_super_d.nr_groups > NFS_GROUP_CNT) {
+        return -NFS_ERROR_INVAL;
+    }
+    
     // 内存超级块nfs_super分配空间
     nfs_super.map_inode = (uint8_t *)malloc(NFS_BLKS_SZ(nfs_super_d.map_inode_blks));
     nfs_super.map_data = (uint8_t *)malloc(NFS_BLKS_SZ(nfs_super_d.map_data_blks));
 
     // 内存超级块nfs_super同步磁盘块nfs_super_d数据
-    nfs_super.sz_usage   = nfs_super_d.sz_usage;
+    nfs_super.journal_blks = nfs_super_d.journal_blks;
+    nfs_super.journal_offset = nfs_super_d.journal_offset;
     
     nfs_super.map_inode_blks = nfs_super_d.map_inode_blks;
     nfs_super.map_inode_offset = nfs_super_d.map_inode_offset;
@@ -624,28 +996,59 @@ int nfs_mount(struct custom_options options){
     nfs_super.map_data_blks = nfs_super_d.map_data_blks;
     nfs_super.map_data_offset = nfs_super_d.map_data_offset;
 
-    nfs_super.inode_offset = nfs_super_d.inode_offset;
-    nfs_super.data_offset = nfs_super_d.data_offset;
+    nfs_super.nr_groups = nfs_super_d.nr_groups;
+    nfs_super.inodes_per_group = nfs_super_d.inodes_per_group;
+    nfs_super.data_per_group = nfs_super_d.data_per_group;
+    nfs_super.group_offset = nfs_super_d.group_offset;
 
-    // 读取inode位图与数据位图
-    if (nfs_driver_read(nfs_super_d.map_inode_offset, (uint8_t *)(nfs_super.map_inode), 
-                        NFS_BLKS_SZ(nfs_super_d.map_inode_blks)) != NFS_ERROR_NONE) {
-        return -NFS_ERROR_IO;
+    // 设置内存超级块属性
+    nfs_super.max_ino = nfs_super.nr_groups * nfs_super.inodes_per_group;
+    nfs_super.max_data = nfs_super.nr_groups * nfs_super.data_per_group;
+    nfs_super.icache   = (struct nfs_inode **)calloc(nfs_super.max_ino, sizeof(struct nfs_inode *));
+
+    // 读取inode位图与数据位图，新格式化的磁盘位图全部清零
+    if (is_init) {
+        memset(nfs_super.map_inode, 0, NFS_BLKS_SZ(nfs_super_d.map_inode_blks));
+        memset(nfs_super.map_data, 0, NFS_BLKS_SZ(nfs_super_d.map_data_blks));
     }
-    if (nfs_driver_read(nfs_super_d.map_data_offset, (uint8_t *)(nfs_super.map_data), 
-                        NFS_BLKS_SZ(nfs_super_d.map_data_blks)) != NFS_ERROR_NONE) {
+    else if (nfs_driver_read(nfs_super_d.map_inode_offset, (uint8_t *)(nfs_super.map_inode), 
+                             NFS_BLKS_SZ(nfs_super_d.map_inode_blks)) != NFS_ERROR_NONE ||
+             nfs_driver_read(nfs_super_d.map_data_offset, (uint8_t *)(nfs_super.map_data), 
+                             NFS_BLKS_SZ(nfs_super_d.map_data_blks)) != NFS_ERROR_NONE) {
         return -NFS_ERROR_IO;
     }
+    // 载入空闲统计，新格式化的磁盘由位图统计
+    ret = nfs_groups_init(is_init ? NULL : nfs_super_d.groups);
+    if (ret != NFS_ERROR_NONE) {
+        return ret;
+    }
 
-    // 若磁盘刚初始化，分配根节点，并同步回磁盘
+    // 若磁盘刚初始化，分配根节点，并立即写回超级块与位图，之后的修改都经由日志
     if (is_init) {
         root_inode = nfs_alloc_inode(root_dentry);
         nfs_sync_inode(root_inode);
+        if (nfs_sync_super() != NFS_ERROR_NONE) {
+            return -NFS_ERROR_IO;
+        }
+    }
+    // 启动日志
+    ret = nfs_jnl_init(jnl_seq, is_init);
+    if (ret != NFS_ERROR_NONE) {
+        return ret;
     }
     // 若磁盘已有数据，读取根节点
     root_inode            = nfs_read_inode(root_dentry, NFS_ROOT_INO);
+    if (root_inode == NULL) {
+        return -NFS_ERROR_IO;
+    }
     root_dentry->inode    = root_inode;
     nfs_super.root_dentry = root_dentry;
+
+    // 继续回收上次未回收完的孤儿inode
+    ret = nfs_reclaim_init(is_init ? -1 : nfs_super_d.orphan_head);
+    if (ret != NFS_ERROR_NONE) {
+        return ret;
+    }
     
     // 设置内存块为已挂载成功
     nfs_super.is_mounted  = TRUE;
@@ -657,42 +1060,50 @@ int nfs_mount(struct custom_options options){
  * 卸载nfs
  */
 int nfs_umount() {
-    struct nfs_super_d  nfs_super_d; 
+    struct ddriver_state state;
+    struct blkio_stats   bio_stats;
+    struct ddriver_vclock vclock = {0};
     // 若未挂载，直接退出
     if (!nfs_super.is_mounted) {
         return NFS_ERROR_NONE;
     }
+    // 回收剩余孤儿，之后提交剩余事务并检查点，日志区清空
+    nfs_reclaim_destroy();
+    if (nfs_jnl_destroy() != NFS_ERROR_NONE) {
+        return -NFS_ERROR_IO;
+    }
     // 从根节点向下刷写节点，在sync函数中递归了整个inode树
     nfs_sync_inode(nfs_super.root_dentry->inode);
     
-    // 磁盘超级块nfs_super_d数据同步内存超级块nfs_super
-    nfs_super_d.magic_num           = NFS_MAGIC_NUM;
-    nfs_super_d.sz_usage            = nfs_super.sz_usage;
-    nfs_super_d.map_inode_blks      = nfs_super.map_inode_blks;
-    nfs_super_d.map_inode_offset    = nfs_super.map_inode_offset;
-    nfs_super_d.map_data_blks       = nfs_super.map_data_blks;
-    nfs_super_d.map_data_offset     = nfs_super.map_data_offset;
-    nfs_super_d.inode_offset        = nfs_super.inode_offset;
-    nfs_super_d.data_offset         = nfs_super.data_offset;
-
-    // 写回超级块
-    if (nfs_driver_write(NFS_SUPER_OFS, (uint8_t *)&nfs_super_d, 
-                     sizeof(struct nfs_super_d)) != NFS_ERROR_NONE) {
-        return -NFS_ERROR_IO;
-    }
-    // 写回inode位图
-    if (nfs_driver_write(nfs_super_d.map_inode_offset, (uint8_t *)(nfs_super.map_inode), 
-                         NFS_BLKS_SZ(nfs_super_d.map_inode_blks)) != NFS_ERROR_NONE) {
+    // 写回超级块与位图
+    if (nfs_sync_super() != NFS_ERROR_NONE) {
         return -NFS_ERROR_IO;
     }
-    // 写回数据位图
-    if (nfs_driver_write(nfs_super_d.map_data_offset, (uint8_t *)(nfs_super.map_data), 
-                         NFS_BLKS_SZ(nfs_super_d.map_data_blks)) != NFS_ERROR_NONE) {
-        return -NFS_ERROR_IO;
+    // 输出驱动读写与寻道次数，用于比较不同分配策略的寻道开销
+    ddriver_ioctl(NFS_DRIVER(), IOC_REQ_DEVICE_STATE, &state);
+    NFS_DBG("[%s] read %d, write %d, seek %d\n", __func__,
+            state.read_cnt, state.write_cnt, state.seek_cnt);
+    blkio_get_stats(&nfs_super.bio, &bio_stats);
+    NFS_DBG("[%s] cache hit %lu, miss %lu, readahead %lu\n", __func__,
+            (unsigned long)bio_stats.nr_hit, (unsigned long)bio_stats.nr_miss,
+            (unsigned long)bio_stats.nr_ra);
+    // 虚拟时钟模式下，设备时间即按延迟模型执行全部请求所需的时间
+    if (ddriver_ioctl(NFS_DRIVER(), IOC_REQ_DEVICE_VCLOCK, &vclock) == 0) {
+        NFS_DBG("[%s] device time %lld us, busy %lld us, qdepth %d\n", __func__,
+                vclock.time_ns / 1000, vclock.busy_ns / 1000, vclock.qdepth);
     }
-    // 释放位图内存空间，关驱动，卸载成功
+    // 释放位图内存空间，整体释放slab中的dentry、inode、缓冲区与文件名arena，关驱动，卸载成功
     free(nfs_super.map_inode);
     free(nfs_super.map_data);
+    free(nfs_super.icache);
+    nfs_groups_destroy();
+    nfs_slab_destroy(&nfs_super.dentry_slab);
+    nfs_slab_destroy(&nfs_super.inode_slab);
+    nfs_slab_destroy(&nfs_super.blk_slab);
+    nfs_names_destroy(&nfs_super.name_arena);
+    nfs_super.root_dentry = NULL;
+    nfs_super.is_mounted  = FALSE;
+    blkio_destroy(&nfs_super.bio);
     ddriver_close(NFS_DRIVER());
 
     return NFS_ERROR_NONE;
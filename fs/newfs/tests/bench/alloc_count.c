@@ -0,0 +1,107 @@
+/**
+ * 内存分配计数：以LD_PRELOAD加载到newfs进程中，统计malloc、calloc、realloc的调用次数，
+ * 进程退出时输出到stderr，格式为 "alloc: malloc N, calloc N, realloc N"
+ *
+ * 编译: gcc -O2 -shared -fPIC alloc_count.c -o alloc_count.so -ldl
+ * 计数包含libfuse处理请求时的分配，比较前后两个版本时二者相同
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+
+static void* (*real_malloc)(size_t);
+static void* (*real_calloc)(size_t, size_t);
+static void* (*real_realloc)(void *, size_t);
+static void  (*real_free)(void *);
+
+static unsigned long nr_malloc;
+static unsigned long nr_calloc;
+static unsigned long nr_realloc;
+
+// dlsym自身会调用calloc，解析完成之前从静态区分配，这部分内存不释放
+static char   boot_buf[4096];
+static size_t boot_used;
+static int    resolving;
+
+static void* boot_alloc(size_t size) {
+    void* p = boot_buf + boot_used;
+    size = (size + 15) & ~(size_t)15;
+    if (boot_used + size > sizeof(boot_buf)) {
+        return NULL;
+    }
+    boot_used += size;
+    return p;
+}
+
+static int is_boot(void* p) {
+    return (char *)p >= boot_buf && (char *)p < boot_buf + sizeof(boot_buf);
+}
+
+static void resolve() {
+    if (resolving) {
+        return;
+    }
+    resolving    = 1;
+    real_malloc  = dlsym(RTLD_NEXT, "malloc");
+    real_calloc  = dlsym(RTLD_NEXT, "calloc");
+    real_realloc = dlsym(RTLD_NEXT, "realloc");
+    real_free    = dlsym(RTLD_NEXT, "free");
+    resolving    = 0;
+}
+
+void* malloc(size_t size) {
+    if (real_malloc == NULL) {
+        resolve();
+        if (real_malloc == NULL) {
+            return boot_alloc(size);
+        }
+    }
+    __atomic_fetch_add(&nr_malloc, 1, __ATOMIC_RELAXED);
+    return real_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size) {
+    if (real_calloc == NULL) {
+        resolve();
+        if (real_calloc == NULL) {
+            return boot_alloc(nmemb * size);        // 静态区初始即为零
+        }
+    }
+    __atomic_fetch_add(&nr_calloc, 1, __ATOMIC_RELAXED);
+    return real_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    void* p;
+    if (real_realloc == NULL) {
+        resolve();
+    }
+    __atomic_fetch_add(&nr_realloc, 1, __ATOMIC_RELAXED);
+    if (is_boot(ptr)) {
+        p = malloc(size);
+        if (p != NULL) {                            // 原大小未知，拷贝到静态区末尾为止
+            size_t left = boot_buf + sizeof(boot_buf) - (char *)ptr;
+            memcpy(p, ptr, size < left ? size : left);
+        }
+        return p;
+    }
+    return real_realloc(ptr, size);
+}
+
+void free(void* ptr) {
+    if (ptr == NULL || is_boot(ptr)) {
+        return;
+    }
+    if (real_free == NULL) {
+        resolve();
+    }
+    real_free(ptr);
+}
+
+__attribute__((destructor))
+static void report() {
+    fprintf(stderr, "alloc: malloc %lu, calloc %lu, realloc %lu\n",
+            nr_malloc, nr_calloc, nr_realloc);
+}
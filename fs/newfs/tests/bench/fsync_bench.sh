@@ -0,0 +1,20 @@
+#!/bin/bash
+# fsync吞吐测试：挂载newfs后运行fsync_bench，结束后卸载并检查重新挂载
+# 用法: ./fsync_bench.sh [线程数] [每线程文件数] [写入字节数]
+
+WORK_DIR=$(cd `dirname $0`; pwd)
+cd $WORK_DIR || exit
+
+MNTPOINT="$WORK_DIR/mnt"
+NEWFS="$WORK_DIR/../../build/newfs"
+
+gcc -O2 -pthread fsync_bench.c -o fsync_bench || exit 1
+
+mkdir -p "$MNTPOINT"
+fusermount -u "$MNTPOINT" 2>/dev/null
+"$NEWFS" --device="$HOME"/ddriver "$MNTPOINT" || exit 1
+sleep 1
+
+./fsync_bench "$MNTPOINT" "${1:-64}" "${2:-4}" "${3:-512}"
+
+fusermount -u "$MNTPOINT"
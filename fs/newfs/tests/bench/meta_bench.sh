@@ -0,0 +1,62 @@
+#!/bin/bash
+# 元数据操作微基准：统计每个元数据操作平均的驱动读写、寻道次数与内存分配次数
+# newfs以LD_PRELOAD加载alloc_count.so计数分配（输出到stderr，单独记录），卸载时输出驱动与块缓存统计；
+# 分别在空盘上运行0轮与N轮，两次之差除以操作数，扣除挂载、卸载本身的开销
+# 每轮依次执行mkdir、创建文件、stat、删除文件、rmdir，共5个元数据操作
+# 用法: ./meta_bench.sh [轮数]
+
+WORK_DIR=$(cd `dirname $0`; pwd)
+cd $WORK_DIR || exit
+
+MNTPOINT="$WORK_DIR/mnt"
+NEWFS="$WORK_DIR/../../build/newfs"
+LOG="$WORK_DIR/meta_bench.log"
+ALLOC_LOG="$WORK_DIR/meta_bench.alloc.log"
+ROUNDS=${1:-200}
+OPS_PER_ROUND=5
+
+gcc -O2 -shared -fPIC alloc_count.c -o alloc_count.so -ldl || exit 1
+
+# 运行rounds轮，输出 "驱动读 驱动写 寻道 分配"
+function run_once() {
+    local rounds=$1
+    rm -f "$HOME"/ddriver
+    touch "$HOME"/ddriver
+    mkdir -p "$MNTPOINT"
+    fusermount -u "$MNTPOINT" 2>/dev/null
+
+    LD_PRELOAD="$WORK_DIR/alloc_count.so" "$NEWFS" -f --device="$HOME"/ddriver "$MNTPOINT" > "$LOG" 2> "$ALLOC_LOG" &
+    NEWFS_PID=$!
+    sleep 1
+
+    for i in $(seq 1 "$rounds"); do
+        mkdir "$MNTPOINT/d$i"
+        touch "$MNTPOINT/d$i/f"
+        stat "$MNTPOINT/d$i/f" > /dev/null
+        rm "$MNTPOINT/d$i/f"
+        rmdir "$MNTPOINT/d$i"
+    done
+
+    fusermount -u "$MNTPOINT"
+    wait $NEWFS_PID
+
+    grep "nfs_umount\] read" "$LOG" | sed -E 's/.*read ([0-9]+), write ([0-9]+), seek ([0-9]+).*/\1 \2 \3/' | tr '\n' ' '
+    grep "alloc: malloc" "$ALLOC_LOG" | sed -E 's/.*malloc ([0-9]+), calloc ([0-9]+), realloc ([0-9]+).*/\1 \2 \3/' \
+        | awk '{ print $1 + $2 + $3 }'
+}
+
+base=($(run_once 0))
+cur=($(run_once "$ROUNDS"))
+ops=$((ROUNDS * OPS_PER_ROUND))
+
+if [ ${#base[@]} -ne 4 ] || [ ${#cur[@]} -ne 4 ]; then
+    echo "统计输出缺失，查看 $LOG"
+    exit 1
+fi
+
+echo "rounds: $ROUNDS, metadata ops: $ops"
+awk -v ops="$ops" \
+    -v r="$((cur[0] - base[0]))" -v w="$((cur[1] - base[1]))" \
+    -v s="$((cur[2] - base[2]))" -v a="$((cur[3] - base[3]))" \
+    'BEGIN { printf("per op: driver read %.2f, write %.2f, seek %.2f, alloc %.2f\n", r / ops, w / ops, s / ops, a / ops) }'
+grep "cache hit" "$LOG"
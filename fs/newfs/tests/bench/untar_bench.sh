@@ -0,0 +1,47 @@
+#!/bin/bash
+# 解包寻道测试：在空盘上挂载newfs，将源码树tar包解到挂载点，卸载时newfs输出驱动的读写与寻道次数
+# 用法: ./untar_bench.sh [tar包]，不指定时生成一个小型源码树（6个目录，每个目录24个1~4KB的文件）
+
+WORK_DIR=$(cd `dirname $0`; pwd)
+cd $WORK_DIR || exit
+
+MNTPOINT="$WORK_DIR/mnt"
+NEWFS="$WORK_DIR/../../build/newfs"
+LOG="$WORK_DIR/untar_bench.log"
+TARBALL="$1"
+
+if [ -z "$TARBALL" ]; then
+    SRC_DIR=$(mktemp -d)
+    for d in $(seq 0 5); do
+        mkdir -p "$SRC_DIR/src/mod$d"
+        for f in $(seq 0 23); do
+            head -c $(( (RANDOM % 4 + 1) * 1000 )) /dev/urandom > "$SRC_DIR/src/mod$d/file$f.c"
+        done
+    done
+    TARBALL="$SRC_DIR/src.tar"
+    tar -C "$SRC_DIR" -cf "$TARBALL" src || exit 1
+fi
+
+rm -f "$HOME"/ddriver
+touch "$HOME"/ddriver
+mkdir -p "$MNTPOINT"
+fusermount -u "$MNTPOINT" 2>/dev/null
+
+# 前台运行以便在卸载时收集统计输出
+"$NEWFS" -f --device="$HOME"/ddriver "$MNTPOINT" > "$LOG" 2>&1 &
+NEWFS_PID=$!
+sleep 1
+
+start=$(date +%s.%N)
+tar --no-same-owner --no-same-permissions -m -xf "$TARBALL" -C "$MNTPOINT"
+end=$(date +%s.%N)
+
+fusermount -u "$MNTPOINT"
+wait $NEWFS_PID
+
+echo "untar: $(echo "$end - $start" | bc) s"
+grep "nfs_umount" "$LOG"
+
+if [ -n "$SRC_DIR" ]; then
+    rm -rf "$SRC_DIR"
+fi
@@ -10,5 +10,6 @@ int ddriver_write(int fd, char *buf, size_t size);
 int ddriver_read(int fd, char *buf, size_t size);
 int ddriver_ioctl(int fd, unsigned long cmd, void *ret);
 int ddriver_close(int fd);
+char *ddriver_map(int fd, off_t offset, size_t size);
 
 #endif /* _DDRIVER_H_ */
\ No newline at end of file
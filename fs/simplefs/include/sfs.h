@@ -10,6 +10,7 @@
 #include "fuse.h"
 #include <stddef.h>
 #include "ddriver.h"
+#include "blkio.h"
 #include "errno.h"
 #include "types.h"
 
@@ -32,7 +33,13 @@ int 			   sfs_umount();
 
 int 			   sfs_alloc_dentry(struct sfs_inode * inode, struct sfs_dentry * dentry);
 int 			   sfs_drop_dentry(struct sfs_inode * inode, struct sfs_dentry * dentry);
+int 			   sfs_alloc_data_slot(int goal);
+void 			   sfs_free_data_slot(int slot);
+void 			   sfs_free_ino(int ino);
+void 			   sfs_release_freed();
+int 			   sfs_rebuild_map_data();
 struct sfs_inode*  sfs_alloc_inode(struct sfs_dentry * dentry);
+int 			   sfs_cow_alloc(struct sfs_inode * inode);
 int 			   sfs_sync_inode(struct sfs_inode * inode);
 int 			   sfs_drop_inode(struct sfs_inode * inode);
 struct sfs_inode*  sfs_read_inode(struct sfs_dentry * dentry, int ino);
@@ -40,6 +47,13 @@ struct sfs_dentry* sfs_get_dentry(struct sfs_inode * inode, int dir);
 
 struct sfs_dentry* sfs_lookup(const char * path, boolean * is_find, boolean* is_root);
 /******************************************************************************
+* SECTION: sfs_page.c
+*******************************************************************************/
+struct sfs_page*   sfs_page_lookup(struct sfs_inode * inode, int index);
+struct sfs_page*   sfs_page_get(struct sfs_inode * inode, int index, boolean is_fill);
+void 			   sfs_page_trim(struct sfs_inode * inode, int from);
+int 			   sfs_page_writeback(struct sfs_inode * inode, int slot);
+/******************************************************************************
 * SECTION: sfs.c
 *******************************************************************************/
 void* 			   sfs_init(struct fuse_conn_info *);
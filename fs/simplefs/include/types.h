@@ -36,6 +36,7 @@ typedef enum sfs_file_type {
 #define SFS_ERROR_UNSUPPORTED   ENXIO
 #define SFS_ERROR_IO            EIO     /* Error Input/Output */
 #define SFS_ERROR_INVAL         EINVAL  /* Invalid Args */
+#define SFS_ERROR_FBIG          EFBIG   /* File too large */
 
 #define SFS_MAX_FILE_NAME       128
 #define SFS_INODE_PER_FILE      1
@@ -47,6 +48,13 @@ typedef enum sfs_file_type {
 
 #define SFS_FLAG_BUF_DIRTY      0x1
 #define SFS_FLAG_BUF_OCCUPY     0x2
+
+#define SFS_RADIX_SHIFT         3                     /* 数据页基数树每层的位数 */
+#define SFS_RADIX_SLOTS         (1 << SFS_RADIX_SHIFT)
+#define SFS_RADIX_MASK          (SFS_RADIX_SLOTS - 1)
+
+#define SFS_BIO_CACHE_BLKS      64                    /* 块I/O缓存块数 */
+#define SFS_BIO_RA_BLKS         16                    /* 顺序读时的预读块数，一个槽位的数据块 */
 /******************************************************************************
 * SECTION: Macro Function
 *******************************************************************************/
@@ -58,11 +66,12 @@ typedef enum sfs_file_type {
 #define SFS_ROUND_UP(value, round)      (value % round == 0 ? value : (value / round + 1) * round)
 
 #define SFS_BLKS_SZ(blks)               (blks * SFS_IO_SZ())
+#define SFS_MAX_FILE_SZ()               (SFS_BLKS_SZ(SFS_DATA_PER_FILE))
 #define SFS_ASSIGN_FNAME(psfs_dentry, _fname)\ 
                                         memcpy(psfs_dentry->fname, _fname, strlen(_fname))
 #define SFS_INO_OFS(ino)                (sfs_super.data_offset + ino * SFS_BLKS_SZ((\
                                         SFS_INODE_PER_FILE + SFS_DATA_PER_FILE)))
-#define SFS_DATA_OFS(ino)               (SFS_INO_OFS(ino) + SFS_BLKS_SZ(SFS_INODE_PER_FILE))
+#define SFS_DATA_OFS(slot)              (SFS_INO_OFS(slot) + SFS_BLKS_SZ(SFS_INODE_PER_FILE))
 
 #define SFS_IS_DIR(pinode)              (pinode->dentry->ftype == SFS_DIR)
 #define SFS_IS_REG(pinode)              (pinode->dentry->ftype == SFS_REG_FILE)
@@ -74,9 +83,21 @@ struct sfs_dentry;
 struct sfs_inode;
 struct sfs_super;
 
+struct sfs_page
+{
+    uint8_t*           data;                          /* 一个IO单元大小的数据 */
+    flag16             flag;                          /* SFS_FLAG_BUF_DIRTY */
+};
+
+struct sfs_radix_node
+{
+    void*              slots[SFS_RADIX_SLOTS];        /* 最底层指向sfs_page，其余指向下层节点 */
+};
+
 struct custom_options {
 	const char*        device;
 	boolean            show_help;
+	boolean            cow;                           /* 写回时数据写入新槽位，不覆盖原数据 */
 };
 
 struct sfs_inode
@@ -87,7 +108,11 @@ struct sfs_inode
     int                dir_cnt;
     struct sfs_dentry* dentry;                        /* 指向该inode的dentry */
     struct sfs_dentry* dentrys;                       /* 所有目录项 */
-    uint8_t*           data;           
+    struct sfs_radix_node* pages;                     /* 数据页基数树，按需分配 */
+    int                page_height;                   /* 基数树高度，0表示没有缓存页 */
+    int                data_slot;                     /* 数据所在槽位，初始与ino相同 */
+    int                cow_slot;                      /* 写回时的新槽位，-1表示原地写回 */
+    boolean            is_dirty;                      /* 数据或属性是否需要写回 */
 };  
 
 struct sfs_dentry
@@ -103,6 +128,7 @@ struct sfs_dentry
 struct sfs_super
 {
     int                driver_fd;
+    struct blkio       bio;                           /* 块I/O：对齐、缓存与预读 */
     
     int                sz_io;
     int                sz_disk;
@@ -112,6 +138,13 @@ struct sfs_super
     uint8_t*           map_inode;
     int                map_inode_blks;
     int                map_inode_offset;
+
+    uint8_t*           map_data;                      /* 数据槽位位图 */
+    int                map_data_blks;
+    int                map_data_offset;
+    int                data_cursor;                   /* 下一次分配槽位的起点，使写回顺序进行 */
+    uint8_t*           map_inode_freed;               /* 写时复制：本次挂载释放的inode，位图落盘后才归还 */
+    uint8_t*           map_data_freed;                /* 写时复制：本次挂载释放的槽位，位图落盘后才归还 */
     
     int                data_offset;
 
@@ -141,6 +174,8 @@ struct sfs_super_d
     int                max_ino;
     int                map_inode_blks;
     int                map_inode_offset;
+    int                map_data_blks;
+    int                map_data_offset;
     int                data_offset;
 };
 
@@ -151,6 +186,7 @@ struct sfs_inode_d
     char               target_path[SFS_MAX_FILE_NAME];/* store traget path when it is a symlink */
     int                dir_cnt;
     SFS_FILE_TYPE      ftype;   
+    int                data_slot;                     /* 数据所在槽位 */
 };  
 
 struct sfs_dentry_d
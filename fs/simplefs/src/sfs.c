@@ -15,6 +15,7 @@ static const struct fuse_opt option_spec[] = {
 	OPTION("--device=%s", device),
 	OPTION("-h", show_help),
 	OPTION("--help", show_help),
+	OPTION("--cow", cow),
 	FUSE_OPT_END
 };
 
@@ -86,6 +87,10 @@ int sfs_mkdir(const char* path, mode_t mode) {
 	dentry = new_dentry(fname, SFS_DIR); 
 	dentry->parent = last_dentry;
 	inode  = sfs_alloc_inode(dentry);
+	if (inode == NULL) {
+		free(dentry);
+		return -SFS_ERROR_NOSPACE;
+	}
 	sfs_alloc_dentry(last_dentry->inode, dentry);
 	
 	return SFS_ERROR_NONE;
@@ -200,6 +205,10 @@ int sfs_mknod(const char* path, mode_t mode, dev_t dev) {
 	}
 	dentry->parent = last_dentry;
 	inode = sfs_alloc_inode(dentry);
+	if (inode == NULL) {
+		free(dentry);
+		return -SFS_ERROR_NOSPACE;
+	}
 	sfs_alloc_dentry(last_dentry->inode, dentry);
 
 	return SFS_ERROR_NONE;
@@ -219,6 +228,9 @@ int sfs_write(const char* path, const char* buf, size_t size, off_t offset,
     boolean	is_find, is_root;
 	struct sfs_dentry* dentry = sfs_lookup(path, &is_find, &is_root);
 	struct sfs_inode*  inode;
+	struct sfs_page*   page;
+	size_t done = 0, len;
+	int    page_ofs;
 	
 	if (is_find == FALSE) {
 		return -SFS_ERROR_NOTFOUND;
@@ -234,8 +246,26 @@ int sfs_write(const char* path, const char* buf, size_t size, off_t offset,
 		return -SFS_ERROR_SEEK;
 	}
 
-	memcpy(inode->data + offset, buf, size);
+	if (offset >= SFS_MAX_FILE_SZ()) {				  /* 数据槽位已写满 */
+		return -SFS_ERROR_FBIG;
+	}
+	if (offset + size > SFS_MAX_FILE_SZ()) {
+		size = SFS_MAX_FILE_SZ() - offset;
+	}
+
+	while (done < size) {							  /* 逐页复制，整页覆盖时不读盘 */
+		page_ofs = (offset + done) % SFS_IO_SZ();
+		len      = SFS_IO_SZ() - page_ofs < size - done ? SFS_IO_SZ() - page_ofs : size - done;
+		page     = sfs_page_get(inode, (offset + done) / SFS_IO_SZ(), len < SFS_IO_SZ());
+		if (page == NULL) {
+			return -SFS_ERROR_IO;
+		}
+		memcpy(page->data + page_ofs, buf + done, len);
+		page->flag |= SFS_FLAG_BUF_DIRTY;
+		done += len;
+	}
 	inode->size = offset + size > inode->size ? offset + size : inode->size;
+	inode->is_dirty = TRUE;
 	
 	return size;
 }
@@ -254,6 +284,9 @@ int sfs_read(const char* path, char* buf, size_t size, off_t offset,
 	boolean	is_find, is_root;
 	struct sfs_dentry* dentry = sfs_lookup(path, &is_find, &is_root);
 	struct sfs_inode*  inode;
+	struct sfs_page*   page;
+	size_t done = 0, len;
+	int    page_ofs;
 
 	if (is_find == FALSE) {
 		return -SFS_ERROR_NOTFOUND;
@@ -265,11 +298,23 @@ int sfs_read(const char* path, char* buf, size_t size, off_t offset,
 		return -SFS_ERROR_ISDIR;	
 	}
 
-	if (inode->size < offset) {
-		return -SFS_ERROR_SEEK;
+	if (offset >= inode->size) {					  /* 文件尾之后没有数据 */
+		return 0;
+	}
+	if (offset + size > inode->size) {
+		size = inode->size - offset;
 	}
 
-	memcpy(buf, inode->data + offset, size);
+	while (done < size) {
+		page_ofs = (offset + done) % SFS_IO_SZ();
+		len      = SFS_IO_SZ() - page_ofs < size - done ? SFS_IO_SZ() - page_ofs : size - done;
+		page     = sfs_page_get(inode, (offset + done) / SFS_IO_SZ(), TRUE);
+		if (page == NULL) {
+			return -SFS_ERROR_IO;
+		}
+		memcpy(buf + done, page->data + page_ofs, len);
+		done += len;
+	}
 
 	return size;			   
 }
@@ -479,6 +524,8 @@ int sfs_truncate(const char* path, off_t offset) {
 	boolean	is_find, is_root;
 	struct sfs_dentry* dentry = sfs_lookup(path, &is_find, &is_root);
 	struct sfs_inode*  inode;
+	struct sfs_page*   page;
+	int    index;
 	
 	if (is_find == FALSE) {
 		return -SFS_ERROR_NOTFOUND;
@@ -490,7 +537,30 @@ int sfs_truncate(const char* path, off_t offset) {
 		return -SFS_ERROR_ISDIR;
 	}
 
+	if (offset > SFS_MAX_FILE_SZ()) {
+		return -SFS_ERROR_FBIG;
+	}
+
+	if (offset < inode->size) {						  /* 缩短：尾页清零，释放之后的页 */
+		page = sfs_page_lookup(inode, offset / SFS_IO_SZ());
+		if (page != NULL && offset % SFS_IO_SZ() != 0) {
+			memset(page->data + offset % SFS_IO_SZ(), 0, SFS_IO_SZ() - offset % SFS_IO_SZ());
+			page->flag |= SFS_FLAG_BUF_DIRTY;
+		}
+		sfs_page_trim(inode, SFS_ROUND_UP(offset, SFS_IO_SZ()) / SFS_IO_SZ());
+	}
+	else {											  /* 伸长：原文件尾之后的页补零并标脏，不读盘上旧内容 */
+		for (index = inode->size / SFS_IO_SZ(); index * SFS_IO_SZ() < offset; index++) {
+			page = sfs_page_get(inode, index, TRUE);
+			if (page == NULL) {
+				return -SFS_ERROR_IO;
+			}
+			page->flag |= SFS_FLAG_BUF_DIRTY;
+		}
+	}
+
 	inode->size = offset;
+	inode->is_dirty = TRUE;
 
 	return SFS_ERROR_NONE;
 }
@@ -506,6 +576,7 @@ void sfs_usage() {
 	printf("\n");
 	printf("Usage: ./sfs-fuse --device=[device path] mntpoint\n");
 	printf("mount device to mntpoint with SFS\n");
+	printf("  --cow  write modified data to new slots on sync instead of in place\n");
 	printf("=================================================================\n");
 	printf("FUSE general options\n");
 	return;
@@ -0,0 +1,194 @@
+#include "../include/sfs.h"
+
+extern struct sfs_super      sfs_super;
+
+/**
+ * 文件数据页缓存
+ *
+ * 每个普通文件在内存中以基数树组织数据页，页大小为一个IO单元：
+ * 1) 页在首次访问时才分配，文件长度以内的页从数据槽位读入，之外的页为零
+ * 2) 树高随最大页号按需增长，每层SFS_RADIX_SLOTS个分支
+ * 3) 页被修改后标记为脏，写回时只写脏页；写时复制写回到新槽位时须写出整个文件
+ */
+
+/* 高度为height的树能容纳的页数 */
+#define SFS_RADIX_CAPACITY(height)      (1 << ((height) * SFS_RADIX_SHIFT))
+
+/**
+ * @brief 查找已缓存的页
+ *
+ * @param inode
+ * @param index 页号
+ * @return struct sfs_page* 未缓存时为NULL
+ */
+struct sfs_page* sfs_page_lookup(struct sfs_inode * inode, int index) {
+    struct sfs_radix_node* node = inode->pages;
+    int height = inode->page_height;
+
+    if (height == 0 || index >= SFS_RADIX_CAPACITY(height)) {
+        return NULL;
+    }
+    while (height > 1) {
+        node = (struct sfs_radix_node *)node->slots[(index >> ((height - 1) * SFS_RADIX_SHIFT))
+                                                    & SFS_RADIX_MASK];
+        if (node == NULL) {
+            return NULL;
+        }
+        height--;
+    }
+    return (struct sfs_page *)node->slots[index & SFS_RADIX_MASK];
+}
+/**
+ * @brief 获取页，未缓存时分配并插入基数树
+ *
+ * @param inode
+ * @param index 页号
+ * @param is_fill 是否需要页中原有内容，整页覆盖写时无需从磁盘读入
+ * @return struct sfs_page* IO错误时为NULL
+ */
+struct sfs_page* sfs_page_get(struct sfs_inode * inode, int index, boolean is_fill) {
+    struct sfs_radix_node* node;
+    struct sfs_page*       page = sfs_page_lookup(inode, index);
+    int    height;
+    int    slot;
+    int    valid;
+
+    if (page != NULL) {
+        return page;
+    }
+                                                      /* 树高不足时在根之上加层 */
+    while (inode->page_height == 0 || index >= SFS_RADIX_CAPACITY(inode->page_height)) {
+        node = (struct sfs_radix_node *)malloc(sizeof(struct sfs_radix_node));
+        memset(node, 0, sizeof(struct sfs_radix_node));
+        node->slots[0] = inode->pages;
+        inode->pages = node;
+        inode->page_height++;
+    }
+                                                      /* 向下补齐中间节点 */
+    node = inode->pages;
+    for (height = inode->page_height; height > 1; height--) {
+        slot = (index >> ((height - 1) * SFS_RADIX_SHIFT)) & SFS_RADIX_MASK;
+        if (node->slots[slot] == NULL) {
+            node->slots[slot] = malloc(sizeof(struct sfs_radix_node));
+            memset(node->slots[slot], 0, sizeof(struct sfs_radix_node));
+        }
+        node = (struct sfs_radix_node *)node->slots[slot];
+    }
+
+    page = (struct sfs_page *)malloc(sizeof(struct sfs_page));
+    page->data = (uint8_t *)malloc(SFS_IO_SZ());
+    page->flag = 0;
+    memset(page->data, 0, SFS_IO_SZ());
+                                                      /* 只读入文件长度以内的部分，之后保持为零 */
+    valid = inode->size - index * SFS_IO_SZ();
+    if (is_fill && valid > 0) {
+        if (sfs_driver_read(SFS_DATA_OFS(inode->data_slot) + SFS_BLKS_SZ(index), page->data,
+                            SFS_IO_SZ()) != SFS_ERROR_NONE) {
+            SFS_DBG("[%s] io error\n", __func__);
+            free(page->data);
+            free(page);
+            return NULL;
+        }
+        if (valid < SFS_IO_SZ()) {
+            memset(page->data + valid, 0, SFS_IO_SZ() - valid);
+        }
+    }
+    node->slots[index & SFS_RADIX_MASK] = page;
+    return page;
+}
+/**
+ * @brief 释放以node为根的子树中页号不小于from的页
+ *
+ * @param node
+ * @param height 子树高度
+ * @param base 子树中第一页的页号
+ * @param from
+ * @return boolean 子树是否已为空，为空时node已被释放
+ */
+static boolean sfs_radix_trim(struct sfs_radix_node * node, int height, int base, int from) {
+    struct sfs_page* page;
+    boolean is_empty = TRUE;
+    int span = SFS_RADIX_CAPACITY(height - 1);
+    int i;
+
+    for (i = 0; i < SFS_RADIX_SLOTS; i++) {
+        if (node->slots[i] == NULL) {
+            continue;
+        }
+        if (base + (i + 1) * span <= from) {          /* 整个分支都在from之前 */
+            is_empty = FALSE;
+            continue;
+        }
+        if (height == 1) {
+            page = (struct sfs_page *)node->slots[i];
+            free(page->data);
+            free(page);
+            node->slots[i] = NULL;
+        }
+        else if (sfs_radix_trim((struct sfs_radix_node *)node->slots[i], height - 1,
+                                base + i * span, from)) {
+            node->slots[i] = NULL;
+        }
+        else {
+            is_empty = FALSE;
+        }
+    }
+    if (is_empty) {
+        free(node);
+    }
+    return is_empty;
+}
+/**
+ * @brief 释放页号不小于from的所有页，from为0时释放整棵树
+ *
+ * @param inode
+ * @param from
+ */
+void sfs_page_trim(struct sfs_inode * inode, int from) {
+    if (inode->page_height == 0) {
+        return;
+    }
+    if (sfs_radix_trim(inode->pages, inode->page_height, 0, from)) {
+        inode->pages = NULL;
+        inode->page_height = 0;
+    }
+}
+/**
+ * @brief 将文件的页写回slot槽位
+ *
+ * 原地写回只写脏页；slot不是当前槽位时（写时复制）须写出文件长度以内的每一页，
+ * 未缓存的页先从当前槽位读入，按页号递增顺序写出
+ *
+ * @param inode
+ * @param slot 目标槽位
+ * @return int
+ */
+int sfs_page_writeback(struct sfs_inode * inode, int slot) {
+    struct sfs_page* page;
+    boolean is_cow = slot != inode->data_slot;
+    int npages = SFS_ROUND_UP(inode->size, SFS_IO_SZ()) / SFS_IO_SZ();
+    int index;
+
+    for (index = 0; index < npages; index++) {
+        page = sfs_page_lookup(inode, index);
+        if (page == NULL) {
+            if (!is_cow) {
+                continue;
+            }
+            page = sfs_page_get(inode, index, TRUE);
+            if (page == NULL) {
+                return -SFS_ERROR_IO;
+            }
+        }
+        else if (!is_cow && !(page->flag & SFS_FLAG_BUF_DIRTY)) {
+            continue;
+        }
+        if (sfs_driver_write(SFS_DATA_OFS(slot) + SFS_BLKS_SZ(index), page->data,
+                             SFS_IO_SZ()) != SFS_ERROR_NONE) {
+            SFS_DBG("[%s] io error\n", __func__);
+            return -SFS_ERROR_IO;
+        }
+        page->flag &= ~SFS_FLAG_BUF_DIRTY;
+    }
+    return SFS_ERROR_NONE;
+}
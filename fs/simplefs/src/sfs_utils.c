@@ -46,22 +46,9 @@ int sfs_calc_lvl(const char * path) {
  * @return int 
  */
 int sfs_driver_read(int offset, uint8_t *out_content, int size) {
-    int      offset_aligned = SFS_ROUND_DOWN(offset, SFS_IO_SZ());
-    int      bias           = offset - offset_aligned;
-    int      size_aligned   = SFS_ROUND_UP((size + bias), SFS_IO_SZ());
-    uint8_t* temp_content   = (uint8_t*)malloc(size_aligned);
-    uint8_t* cur            = temp_content;
-    // lseek(SFS_DRIVER(), offset_aligned, SEEK_SET);
-    ddriver_seek(SFS_DRIVER(), offset_aligned, SEEK_SET);
-    while (size_aligned != 0)
-    {
-        // read(SFS_DRIVER(), cur, SFS_IO_SZ());
-        ddriver_read(SFS_DRIVER(), cur, SFS_IO_SZ());
-        cur          += SFS_IO_SZ();
-        size_aligned -= SFS_IO_SZ();   
+    if (blkio_read(&sfs_super.bio, offset, out_content, size) != 0) {
+        return -SFS_ERROR_IO;
     }
-    memcpy(out_content, temp_content + bias, size);
-    free(temp_content);
     return SFS_ERROR_NONE;
 }
 /**
@@ -73,25 +60,9 @@ int sfs_driver_read(int offset, uint8_t *out_content, int size) {
  * @return int 
  */
 int sfs_driver_write(int offset, uint8_t *in_content, int size) {
-    int      offset_aligned = SFS_ROUND_DOWN(offset, SFS_IO_SZ());
-    int      bias           = offset - offset_aligned;
-    int      size_aligned   = SFS_ROUND_UP((size + bias), SFS_IO_SZ());
-    uint8_t* temp_content   = (uint8_t*)malloc(size_aligned);
-    uint8_t* cur            = temp_content;
-    sfs_driver_read(offset_aligned, temp_content, size_aligned);
-    memcpy(temp_content + bias, in_content, size);
-    
-    // lseek(SFS_DRIVER(), offset_aligned, SEEK_SET);
-    ddriver_seek(SFS_DRIVER(), offset_aligned, SEEK_SET);
-    while (size_aligned != 0)
-    {
-        // write(SFS_DRIVER(), cur, SFS_IO_SZ());
-        ddriver_write(SFS_DRIVER(), cur, SFS_IO_SZ());
-        cur          += SFS_IO_SZ();
-        size_aligned -= SFS_IO_SZ();   
+    if (blkio_write(&sfs_super.bio, offset, in_content, size) != 0) {
+        return -SFS_ERROR_IO;
     }
-
-    free(temp_content);
     return SFS_ERROR_NONE;
 }
 /**
@@ -110,6 +81,7 @@ int sfs_alloc_dentry(struct sfs_inode* inode, struct sfs_dentry* dentry) {
         inode->dentrys = dentry;
     }
     inode->dir_cnt++;
+    inode->is_dirty = TRUE;
     return inode->dir_cnt;
 }
 /**
@@ -143,19 +115,114 @@ int sfs_drop_dentry(struct sfs_inode * inode, struct sfs_dentry * dentry) {
         return -SFS_ERROR_NOTFOUND;
     }
     inode->dir_cnt--;
+    inode->is_dirty = TRUE;
     return inode->dir_cnt;
 }
+/**
+ * @brief 分配一个数据槽位，占用数据位图
+ * 
+ * 每个槽位是SFS_DATA_PER_FILE个连续的块，从goal开始向后找；
+ * 不指定goal时从上次分配处继续，使一次写回中新分配的槽位前后相邻
+ * 
+ * @param goal 期望的槽位，-1表示从游标处开始
+ * @return int 槽位号，无空闲时为-SFS_ERROR_NOSPACE
+ */
+int sfs_alloc_data_slot(int goal) {
+    int start = goal >= 0 ? goal : sfs_super.data_cursor;
+    int slot;
+    int i;
+
+    for (i = 0; i < sfs_super.max_ino; i++) {
+        slot = (start + i) % sfs_super.max_ino;
+        if ((sfs_super.map_data[slot / UINT8_BITS] & (0x1 << (slot % UINT8_BITS))) == 0) {
+            sfs_super.map_data[slot / UINT8_BITS] |= (0x1 << (slot % UINT8_BITS));
+            sfs_super.data_cursor = (slot + 1) % sfs_super.max_ino;
+            return slot;
+        }
+    }
+    return -SFS_ERROR_NOSPACE;
+}
+/**
+ * @brief 释放一个数据槽位
+ * 
+ * 写时复制时磁盘上的目录与inode位图仍可能引用该槽位，先记入map_data_freed，
+ * 保持占用直到sfs_umount将位图落盘，本次挂载内不会被重新分配
+ * 
+ * @param slot 
+ */
+void sfs_free_data_slot(int slot) {
+    if (sfs_options.cow) {
+        sfs_super.map_data_freed[slot / UINT8_BITS] |= (0x1 << (slot % UINT8_BITS));
+        return;
+    }
+    sfs_super.map_data[slot / UINT8_BITS] &= (uint8_t)(~(0x1 << (slot % UINT8_BITS)));
+}
+/**
+ * @brief 释放一个inode编号，写时复制时与sfs_free_data_slot一样推迟归还
+ * 
+ * @param ino 
+ */
+void sfs_free_ino(int ino) {
+    if (sfs_options.cow) {
+        sfs_super.map_inode_freed[ino / UINT8_BITS] |= (0x1 << (ino % UINT8_BITS));
+        return;
+    }
+    sfs_super.map_inode[ino / UINT8_BITS] &= (uint8_t)(~(0x1 << (ino % UINT8_BITS)));
+}
+/**
+ * @brief 归还推迟释放的inode与槽位，须在写回全部完成后调用
+ */
+void sfs_release_freed() {
+    int i;
+    for (i = 0; i < SFS_BLKS_SZ(sfs_super.map_inode_blks); i++) {
+        sfs_super.map_inode[i] &= (uint8_t)(~sfs_super.map_inode_freed[i]);
+        sfs_super.map_inode_freed[i] = 0;
+    }
+    for (i = 0; i < SFS_BLKS_SZ(sfs_super.map_data_blks); i++) {
+        sfs_super.map_data[i] &= (uint8_t)(~sfs_super.map_data_freed[i]);
+        sfs_super.map_data_freed[i] = 0;
+    }
+}
+/**
+ * @brief 按磁盘上存活的inode重建数据位图
+ * 
+ * 写时复制在新槽位落盘后、inode切换前崩溃时，新槽位已在数据位图中占用却无人引用；
+ * 挂载时只保留inode位图中各inode当前指向的槽位，泄漏的槽位由此回收
+ * 
+ * @return int 
+ */
+int sfs_rebuild_map_data() {
+    struct sfs_inode_d inode_d;
+    int ino;
+
+    memset(sfs_super.map_data, 0, SFS_BLKS_SZ(sfs_super.map_data_blks));
+    for (ino = 0; ino < sfs_super.max_ino; ino++) {
+        if ((sfs_super.map_inode[ino / UINT8_BITS] & (0x1 << (ino % UINT8_BITS))) == 0) {
+            continue;
+        }
+        if (sfs_driver_read(SFS_INO_OFS(ino), (uint8_t *)&inode_d, 
+                            sizeof(struct sfs_inode_d)) != SFS_ERROR_NONE) {
+            return -SFS_ERROR_IO;
+        }
+        if (inode_d.data_slot < 0 || inode_d.data_slot >= sfs_super.max_ino) {
+            continue;
+        }
+        sfs_super.map_data[inode_d.data_slot / UINT8_BITS] |= (0x1 << (inode_d.data_slot % UINT8_BITS));
+    }
+    return SFS_ERROR_NONE;
+}
 /**
  * @brief 分配一个inode，占用位图
  * 
  * @param dentry 该dentry指向分配的inode
- * @return sfs_inode
+ * @return sfs_inode 没有空闲inode或数据槽位时为NULL
  */
 struct sfs_inode* sfs_alloc_inode(struct sfs_dentry * dentry) {
     struct sfs_inode* inode;
     int byte_cursor = 0; 
     int bit_cursor  = 0; 
     int ino_cursor  = 0;
+    int data_slot;
     boolean is_find_free_entry = FALSE;
 
     for (byte_cursor = 0; byte_cursor < SFS_BLKS_SZ(sfs_super.map_inode_blks); 
@@ -176,7 +243,13 @@ struct sfs_inode* sfs_alloc_inode(struct sfs_dentry * dentry) {
     }
 
     if (!is_find_free_entry || ino_cursor == sfs_super.max_ino)
-        return -SFS_ERROR_NOSPACE;
+        return NULL;
+                                                      /* 写时复制的新槽位可能占满数据位图 */
+    data_slot = sfs_alloc_data_slot(ino_cursor);
+    if (data_slot < 0) {
+        sfs_super.map_inode[byte_cursor] &= (uint8_t)(~(0x1 << bit_cursor));
+        return NULL;
+    }
 
     inode = (struct sfs_inode*)malloc(sizeof(struct sfs_inode));
     inode->ino  = ino_cursor; 
@@ -189,15 +262,49 @@ struct sfs_inode* sfs_alloc_inode(struct sfs_dentry * dentry) {
     
     inode->dir_cnt = 0;
     inode->dentrys = NULL;
-    
-    if (SFS_IS_REG(inode)) {
-        inode->data = (uint8_t *)malloc(SFS_BLKS_SZ(SFS_DATA_PER_FILE));
-    }
+    inode->data_slot = data_slot;
+    inode->cow_slot  = -1;
+    inode->is_dirty  = TRUE;
+    inode->pages       = NULL;                        /* 数据页在首次读写时分配 */
+    inode->page_height = 0;
 
     return inode;
 }
 /**
- * @brief 将内存inode及其下方结构全部刷回磁盘
+ * @brief 写时复制的第一遍：为需要写回的inode分配新槽位
+ * 
+ * 须在任何inode切换槽位之前完成，调用者随后将新旧槽位都被占用的数据位图落盘，
+ * 崩溃时无论inode指向新槽位还是旧槽位，其数据都不会被重新分配覆盖
+ * 
+ * @param inode 
+ * @return int 
+ */
+int sfs_cow_alloc(struct sfs_inode * inode) {
+    struct sfs_dentry*  dentry_cursor;
+    int slot;
+
+    if (inode->is_dirty && inode->cow_slot < 0) {
+        slot = sfs_alloc_data_slot(-1);
+        inode->cow_slot = slot >= 0 ? slot : -1;      /* 没有空闲槽位时退化为原地写回 */
+    }
+    if (SFS_IS_DIR(inode)) {
+        dentry_cursor = inode->dentrys;
+        while (dentry_cursor != NULL)
+        {
+            if (dentry_cursor->inode != NULL) {
+                sfs_cow_alloc(dentry_cursor->inode);
+            }
+            dentry_cursor = dentry_cursor->brother;
+        }
+    }
+    return SFS_ERROR_NONE;
+}
+/**
+ * @brief 将内存inode及其下方结构全部刷回磁盘，只写回被修改过的inode
+ * 
+ * 已由sfs_cow_alloc分配新槽位的inode，数据整段顺序写入新槽位，
+ * 随后写inode（一个IO单元，原子）完成切换，最后释放旧槽位。
+ * 先写回子inode再写目录本身，已落盘的目录项总指向已写好的inode
  * 
  * @param inode 
  * @return int 
@@ -207,48 +314,63 @@ int sfs_sync_inode(struct sfs_inode * inode) {
     struct sfs_dentry*  dentry_cursor;
     struct sfs_dentry_d dentry_d;
     int ino             = inode->ino;
-    inode_d.ino         = ino;
-    inode_d.size        = inode->size;
-    memcpy(inode_d.target_path, inode->target_path, SFS_MAX_FILE_NAME);
-    inode_d.ftype       = inode->dentry->ftype;
-    inode_d.dir_cnt     = inode->dir_cnt;
+    int slot            = inode->cow_slot >= 0 ? inode->cow_slot : inode->data_slot;
     int offset;
-    
-    if (sfs_driver_write(SFS_INO_OFS(ino), (uint8_t *)&inode_d, 
-                     sizeof(struct sfs_inode_d)) != SFS_ERROR_NONE) {
-        SFS_DBG("[%s] io error\n", __func__);
-        return -SFS_ERROR_IO;
-    }
-                                                      /* Cycle 1: 写 INODE */
-                                                      /* Cycle 2: 写 数据 */
-    if (SFS_IS_DIR(inode)) {                          
+                                                      /* 先递归写回子inode */
+    if (SFS_IS_DIR(inode)) {
         dentry_cursor = inode->dentrys;
-        offset        = SFS_DATA_OFS(ino);
         while (dentry_cursor != NULL)
         {
-            memcpy(dentry_d.fname, dentry_cursor->fname, SFS_MAX_FILE_NAME);
-            dentry_d.ftype = dentry_cursor->ftype;
-            dentry_d.ino = dentry_cursor->ino;
-            if (sfs_driver_write(offset, (uint8_t *)&dentry_d, 
-                                 sizeof(struct sfs_dentry_d)) != SFS_ERROR_NONE) {
-                SFS_DBG("[%s] io error\n", __func__);
-                return -SFS_ERROR_IO;                     
-            }
-            
-            if (dentry_cursor->inode != NULL) {
-                sfs_sync_inode(dentry_cursor->inode);
+            if (dentry_cursor->inode != NULL &&
+                sfs_sync_inode(dentry_cursor->inode) != SFS_ERROR_NONE) {
+                return -SFS_ERROR_IO;
             }
-
             dentry_cursor = dentry_cursor->brother;
-            offset += sizeof(struct sfs_dentry_d);
         }
     }
-    else if (SFS_IS_REG(inode)) {
-        if (sfs_driver_write(SFS_DATA_OFS(ino), inode->data, 
-                             SFS_BLKS_SZ(SFS_DATA_PER_FILE)) != SFS_ERROR_NONE) {
+
+    if (inode->is_dirty) {
+                                                      /* Cycle 1: 写 数据 */
+        if (SFS_IS_DIR(inode)) {                          
+            dentry_cursor = inode->dentrys;
+            offset        = SFS_DATA_OFS(slot);
+            while (dentry_cursor != NULL)
+            {
+                memcpy(dentry_d.fname, dentry_cursor->fname, SFS_MAX_FILE_NAME);
+                dentry_d.ftype = dentry_cursor->ftype;
+                dentry_d.ino = dentry_cursor->ino;
+                if (sfs_driver_write(offset, (uint8_t *)&dentry_d, 
+                                     sizeof(struct sfs_dentry_d)) != SFS_ERROR_NONE) {
+                    SFS_DBG("[%s] io error\n", __func__);
+                    return -SFS_ERROR_IO;                     
+                }
+                dentry_cursor = dentry_cursor->brother;
+                offset += sizeof(struct sfs_dentry_d);
+            }
+        }
+        else if (SFS_IS_REG(inode)) {
+            if (sfs_page_writeback(inode, slot) != SFS_ERROR_NONE) {
+                return -SFS_ERROR_IO;
+            }
+        }
+                                                      /* Cycle 2: 写 INODE，切换到新槽位 */
+        inode_d.ino         = ino;
+        inode_d.size        = inode->size;
+        memcpy(inode_d.target_path, inode->target_path, SFS_MAX_FILE_NAME);
+        inode_d.ftype       = inode->dentry->ftype;
+        inode_d.dir_cnt     = inode->dir_cnt;
+        inode_d.data_slot   = slot;
+        if (sfs_driver_write(SFS_INO_OFS(ino), (uint8_t *)&inode_d, 
+                         sizeof(struct sfs_inode_d)) != SFS_ERROR_NONE) {
             SFS_DBG("[%s] io error\n", __func__);
             return -SFS_ERROR_IO;
         }
+        if (inode->cow_slot >= 0) {
+            sfs_free_data_slot(inode->data_slot);
+            inode->data_slot = inode->cow_slot;
+            inode->cow_slot  = -1;
+        }
+        inode->is_dirty = FALSE;
     }
     return SFS_ERROR_NONE;
 }
@@ -285,11 +407,6 @@ int sfs_drop_inode(struct sfs_inode * inode) {
     struct sfs_dentry*  dentry_to_free;
     struct sfs_inode*   inode_cursor;
 
-    int byte_cursor = 0; 
-    int bit_cursor  = 0; 
-    int ino_cursor  = 0;
-    boolean is_find = FALSE;
-
     if (inode == sfs_super.root_dentry->inode) {
         return SFS_ERROR_INVAL;
     }
@@ -308,23 +425,9 @@ int sfs_drop_inode(struct sfs_inode * inode) {
         }
     }
     else if (SFS_IS_REG(inode) || SFS_IS_SYM_LINK(inode)) {
-        for (byte_cursor = 0; byte_cursor < SFS_BLKS_SZ(sfs_super.map_inode_blks); 
-            byte_cursor++)                            /* 调整inodemap */
-        {
-            for (bit_cursor = 0; bit_cursor < UINT8_BITS; bit_cursor++) {
-                if (ino_cursor == inode->ino) {
-                     sfs_super.map_inode[byte_cursor] &= (uint8_t)(~(0x1 << bit_cursor));
-                     is_find = TRUE;
-                     break;
-                }
-                ino_cursor++;
-            }
-            if (is_find == TRUE) {
-                break;
-            }
-        }
-        if (inode->data)
-            free(inode->data);
+        sfs_free_ino(inode->ino);                     /* 调整inodemap */
+        sfs_free_data_slot(inode->data_slot);
+        sfs_page_trim(inode, 0);
         free(inode);
     }
     return SFS_ERROR_NONE;
@@ -351,13 +454,18 @@ struct sfs_inode* sfs_read_inode(struct sfs_dentry * dentry, int ino) {
     inode->ino = inode_d.ino;
     inode->size = inode_d.size;
     memcpy(inode->target_path, inode_d.target_path, SFS_MAX_FILE_NAME);
+    inode->data_slot = inode_d.data_slot;
+    inode->cow_slot  = -1;
+    inode->is_dirty  = FALSE;
+    inode->pages       = NULL;
+    inode->page_height = 0;
     inode->dentry = dentry;
     inode->dentrys = NULL;
     if (SFS_IS_DIR(inode)) {
         dir_cnt = inode_d.dir_cnt;
         for (i = 0; i < dir_cnt; i++)
         {
-            if (sfs_driver_read(SFS_DATA_OFS(ino) + i * sizeof(struct sfs_dentry_d), 
+            if (sfs_driver_read(SFS_DATA_OFS(inode->data_slot) + i * sizeof(struct sfs_dentry_d), 
                                 (uint8_t *)&dentry_d, 
                                 sizeof(struct sfs_dentry_d)) != SFS_ERROR_NONE) {
                 SFS_DBG("[%s] io error\n", __func__);
@@ -368,14 +476,7 @@ struct sfs_inode* sfs_read_inode(struct sfs_dentry * dentry, int ino) {
             sub_dentry->ino    = dentry_d.ino; 
             sfs_alloc_dentry(inode, sub_dentry);
         }
-    }
-    else if (SFS_IS_REG(inode)) {
-        inode->data = (uint8_t *)malloc(SFS_BLKS_SZ(SFS_DATA_PER_FILE));
-        if (sfs_driver_read(SFS_DATA_OFS(ino), (uint8_t *)inode->data, 
-                            SFS_BLKS_SZ(SFS_DATA_PER_FILE)) != SFS_ERROR_NONE) {
-            SFS_DBG("[%s] io error\n", __func__);
-            return NULL;                    
-        }
+        inode->is_dirty = FALSE;                      /* 读入的目录项无需写回 */
     }
     return inode;
 }
@@ -422,7 +523,7 @@ struct sfs_dentry* sfs_lookup(const char * path, boolean* is_find, boolean* is_r
     int   lvl = 0;
     boolean is_hit;
     char* fname = NULL;
-    char* path_cpy = (char*)malloc(sizeof(path));
+    char* path_cpy = (char*)malloc(strlen(path) + 1);
     *is_root = FALSE;
     strcpy(path_cpy, path);
 
@@ -436,7 +537,7 @@ struct sfs_dentry* sfs_lookup(const char * path, boolean* is_find, boolean* is_r
     {   
         lvl++;
         if (dentry_cursor->inode == NULL) {           /* Cache机制 */
-            sfs_read_inode(dentry_cursor, dentry_cursor->ino);
+            dentry_cursor->inode = sfs_read_inode(dentry_cursor, dentry_cursor->ino);
         }
 
         inode = dentry_cursor->inode;
@@ -479,13 +580,14 @@ struct sfs_dentry* sfs_lookup(const char * path, boolean* is_find, boolean* is_r
         dentry_ret->inode = sfs_read_inode(dentry_ret, dentry_ret->ino);
     }
     
+    free(path_cpy);
     return dentry_ret;
 }
 /**
  * @brief 挂载sfs, Layout 如下
  * 
  * Layout
- * | Super | Inode Map | Data |
+ * | Super | Inode Map | Data Map | Data |
  * 
  * IO_SZ = BLK_SZ
  * 
@@ -502,6 +604,7 @@ int sfs_mount(struct custom_options options){
 
     int                 inode_num;
     int                 map_inode_blks;
+    int                 map_data_blks;
     
     int                 super_blks;
     boolean             is_init = FALSE;
@@ -518,6 +621,11 @@ int sfs_mount(struct custom_options options){
     sfs_super.driver_fd = driver_fd;
     ddriver_ioctl(SFS_DRIVER(), IOC_REQ_DEVICE_SIZE,  &sfs_super.sz_disk);
     ddriver_ioctl(SFS_DRIVER(), IOC_REQ_DEVICE_IO_SZ, &sfs_super.sz_io);
+    if (blkio_init(&sfs_super.bio, SFS_DRIVER(), SFS_IO_SZ(),
+                   SFS_BIO_CACHE_BLKS, SFS_BIO_RA_BLKS) != 0) {
+        ddriver_close(SFS_DRIVER());
+        return -SFS_ERROR_IO;
+    }
     
     root_dentry = new_dentry("/", SFS_DIR);
 
@@ -534,32 +642,55 @@ int sfs_mount(struct custom_options options){
 
         map_inode_blks = SFS_ROUND_UP(SFS_ROUND_UP(inode_num, UINT32_BITS), SFS_IO_SZ()) 
                          / SFS_IO_SZ();
+                                                      /* 每个inode对应一个数据槽位 */
+        map_data_blks  = map_inode_blks;
         
                                                       /* 布局layout */
-        sfs_super.max_ino = (inode_num - super_blks - map_inode_blks); 
+        sfs_super_d.max_ino = (inode_num - super_blks - map_inode_blks - map_data_blks); 
         sfs_super_d.map_inode_offset = SFS_SUPER_OFS + SFS_BLKS_SZ(super_blks);
-        sfs_super_d.data_offset = sfs_super_d.map_inode_offset + SFS_BLKS_SZ(map_inode_blks);
+        sfs_super_d.map_data_offset = sfs_super_d.map_inode_offset + SFS_BLKS_SZ(map_inode_blks);
+        sfs_super_d.data_offset = sfs_super_d.map_data_offset + SFS_BLKS_SZ(map_data_blks);
         sfs_super_d.map_inode_blks  = map_inode_blks;
+        sfs_super_d.map_data_blks   = map_data_blks;
         sfs_super_d.sz_usage    = 0;
         SFS_DBG("inode map blocks: %d\n", map_inode_blks);
         is_init = TRUE;
     }
     sfs_super.sz_usage   = sfs_super_d.sz_usage;      /* 建立 in-memory 结构 */
+    sfs_super.max_ino    = sfs_super_d.max_ino;
     
     sfs_super.map_inode = (uint8_t *)malloc(SFS_BLKS_SZ(sfs_super_d.map_inode_blks));
     sfs_super.map_inode_blks = sfs_super_d.map_inode_blks;
     sfs_super.map_inode_offset = sfs_super_d.map_inode_offset;
     sfs_super.data_offset = sfs_super_d.data_offset;
 
+    sfs_super.map_data = (uint8_t *)malloc(SFS_BLKS_SZ(sfs_super_d.map_data_blks));
+    sfs_super.map_data_blks = sfs_super_d.map_data_blks;
+    sfs_super.map_data_offset = sfs_super_d.map_data_offset;
+    sfs_super.data_cursor = 0;
+    sfs_super.map_inode_freed = (uint8_t *)calloc(1, SFS_BLKS_SZ(sfs_super_d.map_inode_blks));
+    sfs_super.map_data_freed  = (uint8_t *)calloc(1, SFS_BLKS_SZ(sfs_super_d.map_data_blks));
+
     if (sfs_driver_read(sfs_super_d.map_inode_offset, (uint8_t *)(sfs_super.map_inode), 
                         SFS_BLKS_SZ(sfs_super_d.map_inode_blks)) != SFS_ERROR_NONE) {
         return -SFS_ERROR_IO;
     }
 
+    if (sfs_driver_read(sfs_super_d.map_data_offset, (uint8_t *)(sfs_super.map_data), 
+                        SFS_BLKS_SZ(sfs_super_d.map_data_blks)) != SFS_ERROR_NONE) {
+        return -SFS_ERROR_IO;
+    }
+
     if (is_init) {                                    /* 分配根节点 */
         root_inode = sfs_alloc_inode(root_dentry);
+        if (root_inode == NULL) {
+            return -SFS_ERROR_NOSPACE;
+        }
         sfs_sync_inode(root_inode);
     }
+    else if (sfs_rebuild_map_data() != SFS_ERROR_NONE) {
+        return -SFS_ERROR_IO;
+    }
     
     root_inode            = sfs_read_inode(root_dentry, SFS_ROOT_INO);
     root_dentry->inode    = root_inode;
@@ -581,11 +712,31 @@ int sfs_umount() {
         return SFS_ERROR_NONE;
     }
 
-    sfs_sync_inode(sfs_super.root_dentry->inode);     /* 从根节点向下刷写节点 */
+    if (sfs_options.cow) {                            /* 先分配新槽位，新旧槽位都占用的位图落盘 */
+        sfs_cow_alloc(sfs_super.root_dentry->inode);
+                                                      /* 新建的inode在目录项落盘前已在inode位图中，
+                                                         已释放的inode与槽位仍占用，旧目录的引用保持有效 */
+        if (sfs_driver_write(sfs_super.map_inode_offset, (uint8_t *)(sfs_super.map_inode), 
+                             SFS_BLKS_SZ(sfs_super.map_inode_blks)) != SFS_ERROR_NONE) {
+            return -SFS_ERROR_IO;
+        }
+        if (sfs_driver_write(sfs_super.map_data_offset, (uint8_t *)(sfs_super.map_data), 
+                             SFS_BLKS_SZ(sfs_super.map_data_blks)) != SFS_ERROR_NONE) {
+            return -SFS_ERROR_IO;
+        }
+    }
+                                                      /* 自底向上刷写节点，根节点最后 */
+    if (sfs_sync_inode(sfs_super.root_dentry->inode) != SFS_ERROR_NONE) {
+        return -SFS_ERROR_IO;
+    }
+    sfs_release_freed();                              /* 不再有引用，随位图一并归还 */
                                                     
     sfs_super_d.magic_num           = SFS_MAGIC_NUM;
+    sfs_super_d.max_ino             = sfs_super.max_ino;
     sfs_super_d.map_inode_blks      = sfs_super.map_inode_blks;
     sfs_super_d.map_inode_offset    = sfs_super.map_inode_offset;
+    sfs_super_d.map_data_blks       = sfs_super.map_data_blks;
+    sfs_super_d.map_data_offset     = sfs_super.map_data_offset;
     sfs_super_d.data_offset         = sfs_super.data_offset;
     sfs_super_d.sz_usage            = sfs_super.sz_usage;
 
@@ -599,7 +750,16 @@ int sfs_umount() {
         return -SFS_ERROR_IO;
     }
 
+    if (sfs_driver_write(sfs_super_d.map_data_offset, (uint8_t *)(sfs_super.map_data), 
+                         SFS_BLKS_SZ(sfs_super_d.map_data_blks)) != SFS_ERROR_NONE) {
+        return -SFS_ERROR_IO;
+    }
+
     free(sfs_super.map_inode);
+    free(sfs_super.map_data);
+    free(sfs_super.map_inode_freed);
+    free(sfs_super.map_data_freed);
+    blkio_destroy(&sfs_super.bio);
     ddriver_close(SFS_DRIVER());
 
     return SFS_ERROR_NONE;
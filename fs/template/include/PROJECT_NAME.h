@@ -10,6 +10,7 @@
 #include "fuse.h"
 #include <stddef.h>
 #include "ddriver.h"
+#include "blkio.h"
 #include "errno.h"
 #include "types.h"
 
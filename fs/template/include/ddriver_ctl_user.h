@@ -13,9 +13,19 @@ struct ddriver_state
     int seek_cnt;
 };
 
+struct ddriver_vclock
+{
+    long long time_ns;
+    long long busy_ns;
+    long long nr_reqs;
+    int qdepth;
+};
+
 #define IOC_REQ_DEVICE_SIZE     _IOR(IOC_MAGIC, 0, int)                     /* 请求查看设备大小 */
 #define IOC_REQ_DEVICE_STATE    _IOR(IOC_MAGIC, 1, struct ddriver_state)    /* 请求设备状态，返回 ddriver_state */
 #define IOC_REQ_DEVICE_RESET    _IO(IOC_MAGIC, 2)                           /* 请求重置设备 */
 #define IOC_REQ_DEVICE_IO_SZ    _IOR(IOC_MAGIC, 3, int)                     /* 请求设备IO大小 */
+#define IOC_REQ_DEVICE_FLUSH    _IO(IOC_MAGIC, 4)                           /* 请求将设备内容刷写到后备存储 */
+#define IOC_REQ_DEVICE_VCLOCK   _IOR(IOC_MAGIC, 5, struct ddriver_vclock)   /* 请求虚拟时钟，返回 ddriver_vclock */
 
 #endif
\ No newline at end of file
@@ -10,6 +10,7 @@ struct custom_options {
 struct PROJECT_NAME_super {
     uint32_t magic;
     int      fd;
+    struct blkio bio;      /* 块读写：任意偏移与长度，带缓存与预读 */
     /* TODO: Define yourself */
 };
 
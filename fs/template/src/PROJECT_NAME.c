@@ -51,6 +51,10 @@ void* PROJECT_NAME_init(struct fuse_conn_info * conn_info) {
 
 	/* 下面是一个控制设备的示例 */
 	super.fd = ddriver_open(PROJECT_NAME_options.device);
+
+	/* 之后用blkio_read/blkio_write读写磁盘，对齐、读-改-写、缓存与预读由blkio完成
+	 * 参数依次为：块大小1024B（须为设备IO单位的整数倍）、缓存64块、顺序读预读8块 */
+	blkio_init(&super.bio, super.fd, 1024, 64, 8);
 	
 	return NULL;
 }
@@ -64,6 +68,7 @@ void* PROJECT_NAME_init(struct fuse_conn_info * conn_info) {
 void PROJECT_NAME_destroy(void* p) {
 	/* TODO: 在这里进行卸载 */
 	
+	blkio_destroy(&super.bio);
 	ddriver_close(super.fd);
 
 	return;
@@ -1,5 +1,6 @@
 #include "../include/ddriver.h"
 #include <linux/fs.h>
+#include <string.h>
 
 int main(int argc, char const *argv[])
 {
@@ -42,6 +43,37 @@ int main(int argc, char const *argv[])
     printf("write_cnt: %d\n", state.write_cnt);
     printf("seek_cnt: %d\n", state.seek_cnt);
 
+    /* Cycle 5: flush, and zero-copy pointer when run with DDRIVER_MMAP=1 */
+    ddriver_seek(fd, 512, SEEK_SET);
+    ddriver_write(fd, buffer, 512);
+    if (ddriver_ioctl(fd, IOC_REQ_DEVICE_FLUSH, NULL) != 0) {
+        return -1;
+    }
+    char *mapped = ddriver_map(fd, 512, 512);
+    if (mapped != NULL) {
+        printf("mapped: %s\n", memcmp(mapped, buffer, 512) == 0 ? "match" : "mismatch");
+    }
+
+    /* Cycle 6: ioctl test - virtual clock, run with DDRIVER_VCLOCK=1 to skip sleeping */
+    struct ddriver_vclock vc;
+    ddriver_ioctl(fd, IOC_REQ_DEVICE_RESET, NULL);
+    ddriver_seek(fd, 0, SEEK_SET);
+    ddriver_read(fd, buffer, 512);
+    ddriver_ioctl(fd, IOC_REQ_DEVICE_VCLOCK, &vc);
+    printf("device time: %lld us, requests: %lld\n", vc.time_ns / 1000, vc.nr_reqs);
+
+    /* Cycle 7: second queue on the same device, with its own head and counters */
+    int fd2 = ddriver_open("/home/students/200110132/ddriver");
+    if (fd2 < 0) {
+        return -1;
+    }
+    ddriver_seek(fd2, 512, SEEK_SET);
+    ddriver_read(fd2, rbuffer, 512);
+    ddriver_ioctl(fd2, IOC_REQ_DEVICE_STATE, &state);
+    printf("queue 2 read_cnt: %d, shared data: %s\n", state.read_cnt,
+           memcmp(rbuffer, buffer, 512) == 0 ? "match" : "mismatch");
+    ddriver_close(fd2);
+
     ddriver_close(fd);
 
     printf("Test Pass :)\n");